@@ -0,0 +1,1040 @@
+#include "sms.h"
+
+// --- Benchmarks (run with: sms_bench <name> [size]) ---
+// Latency samples of one operation, in seconds
+struct LatencySamples {
+    vector<double> secs;
+    void merge(const LatencySamples& o) { secs.insert(secs.end(), o.secs.begin(), o.secs.end()); }
+    double percentile(double p) {
+        if (secs.empty()) return 0;
+        size_t k = min(secs.size() - 1, (size_t)(p * secs.size()));
+        nth_element(secs.begin(), secs.begin() + k, secs.end());
+        return secs[k];
+    }
+};
+
+// Heap allocations made by this thread, counted by the global operator new
+// below. Only this program replaces it; sms keeps the library's.
+thread_local uint64_t heapAllocations = 0;
+void* operator new(size_t n) {
+    ++heapAllocations;
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+// Kept out of line: GCC flags a free() it can see paired with a new
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept {
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept { ::operator delete(p); }
+
+// The file scan exactly as studentExistsCI used to do it, kept for comparison
+bool legacyStudentExistsCI(const string& path, const string& id) {
+    ifstream fin(path.c_str());
+    string line;
+    while (getline(fin, line)) {
+        istringstream iss(line);
+        string sid;
+        getline(iss, sid, ',');
+        if (equalsIgnoreCase(trim(sid), trim(id))) return true;
+    }
+    return false;
+}
+
+void benchIndex(size_t n) {
+    cout << "Existence check, " << n << " students\n";
+    vector<StudentRecord> students;
+    students.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        string id = "S" + to_string(100000 + i);
+        students.push_back({id, "Bench Student", id + "@school.edu", "20", "BS IT", "pw"});
+    }
+    string path = "bench_students.txt";
+    {
+        ofstream fout(path.c_str());
+        for (size_t i = 0; i < n; ++i) RecordFiles::writeStudent(fout, viewOf(students[i]));
+    }
+
+    // Mixed-case hits spread over the file plus some misses
+    vector<string> queries;
+    for (size_t i = 0; i < 16; ++i) queries.push_back("s" + to_string(100000 + (n - 1) * i / 15));
+    for (size_t i = 0; i < 4; ++i) queries.push_back("missing" + to_string(i));
+
+    size_t hits = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < queries.size(); ++i) hits += legacyStudentExistsCI(path, queries[i]);
+    double scanSecs = secondsSince(start) / queries.size();
+    remove(path.c_str());
+
+    start = chrono::steady_clock::now();
+    FoldedKeyIndex index;
+    index.reserve(n);
+    for (size_t i = 0; i < n; ++i) index.insert(students[i].id, (uint32_t)i);
+    double buildSecs = secondsSince(start);
+
+    auto keyAt = [&students](uint32_t slot) -> const string& { return students[slot].id; };
+    const size_t rounds = 1000000;
+    size_t indexHits = 0;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i) indexHits += index.find(queries[i % queries.size()], keyAt) >= 0;
+    double indexSecs = secondsSince(start) / rounds;
+
+    cout << fixed << setprecision(3);
+    cout << "  file scan:   " << scanSecs * 1e6 << " us/lookup (" << hits << "/" << queries.size() << " hits)\n";
+    cout << "  hash index:  " << indexSecs * 1e9 << " ns/lookup (" << indexHits * queries.size() / rounds
+         << "/" << queries.size() << " hits), built in " << buildSecs * 1e3 << " ms\n";
+    cout << "  speedup:     " << setprecision(0) << scanSecs / indexSecs << "x\n";
+}
+
+// Text search over generated names: build cost, then top-k latency for
+// prefixes, typos and partial IDs, against a substring scan of every record
+const char* const FIRST[] = {"James", "Maria", "Jose", "Ana", "John", "Mary", "Mark", "Grace", "Paolo", "Andrea",
+                             "Miguel", "Sofia", "Daniel", "Angela", "Carlo", "Patricia", "Rafael", "Kristine",
+                             "Joshua", "Nicole", "Gabriel", "Camille", "Vincent", "Bianca", "Adrian", "Isabel"};
+const char* const LAST[] = {"Santos", "Reyes", "Cruz", "Bautista", "Garcia", "Mendoza", "Torres", "Villanueva",
+                            "Ramos", "Aquino", "Castillo", "Fernandez", "Navarro", "Dela Cruz", "Gonzales",
+                            "Lopez", "Morales", "Pascual", "Salazar", "Valdez", "Smith", "Johnson", "Tan", "Lim"};
+const size_t FIRST_COUNT = sizeof(FIRST) / sizeof(FIRST[0]), LAST_COUNT = sizeof(LAST) / sizeof(LAST[0]);
+
+void benchSearch(size_t n) {
+    cout << "Text search, " << n << " students\n";
+    mt19937 rng(7);
+    vector<string> texts(n);
+    for (size_t i = 0; i < n; ++i) {
+        string first = FIRST[rng() % FIRST_COUNT], middle = FIRST[rng() % FIRST_COUNT], last = LAST[rng() % LAST_COUNT];
+        string local = foldCase(first + "." + last) + to_string(rng() % 1000);
+        replace(local.begin(), local.end(), ' ', '_');
+        texts[i] = "S" + to_string(100000 + i) + " " + first + " " + middle + " " + last + " " + local;
+    }
+
+    auto start = chrono::steady_clock::now();
+    TextIndex index;
+    index.build(n, [&texts](size_t i, string& text) {
+        text = texts[i];
+        return true;
+    });
+    double buildSecs = secondsSince(start);
+    cout << fixed << setprecision(1) << "  build: " << buildSecs * 1e3 << " ms, " << index.wordCount() << " distinct words\n";
+
+    string someId = "S" + to_string(100000 + n / 3);
+    const char* queries[] = {"vil", "villan", "vilanueva", "grace ram", "kristine valdes", "patrica fernandez sal",
+                             someId.c_str(), "s1234", "nobody"};
+    const size_t k = 10, rounds = 200;
+    cout << "  " << left << setw(24) << "query" << right << setw(8) << "hits" << setw(12) << "p50 us" << setw(12)
+         << "p99 us" << setw(12) << "scan us" << "\n";
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); ++q) {
+        LatencySamples lat;
+        size_t hits = 0;
+        for (size_t r = 0; r < rounds; ++r) {
+            start = chrono::steady_clock::now();
+            hits = index.search(queries[q], k).size();
+            lat.secs.push_back(secondsSince(start));
+        }
+        // What finding a record by name costs without an index
+        string needle = foldCase(queries[q]);
+        start = chrono::steady_clock::now();
+        size_t scanned = 0;
+        for (size_t i = 0; i < n; ++i) scanned += foldCase(texts[i]).find(needle) != string::npos;
+        double scanSecs = secondsSince(start);
+        cout << "  " << left << setw(24) << queries[q] << right << setw(8) << hits << setprecision(1) << setw(12)
+             << lat.percentile(0.50) * 1e6 << setw(12) << lat.percentile(0.99) * 1e6 << setw(12) << scanSecs * 1e6
+             << (scanned ? "" : " (scan: no exact hit)") << "\n";
+    }
+}
+
+// Student rows as records vs in the column table: heap held, and a
+// program + age range scan the way an unindexed search runs
+void benchTable(size_t n) {
+    static const char* PROGRAMS[] = {"BS IT", "BS CS", "BS Nursing", "AB Communication", "BS Accountancy", "BS Psychology"};
+    cout << "Student table, " << n << " students\n";
+    mt19937 rng(11);
+    vector<StudentRecord> records;
+    records.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        string first = FIRST[rng() % FIRST_COUNT], last = LAST[rng() % LAST_COUNT];
+        string local = foldCase(first + "." + last) + to_string(rng() % 1000);
+        replace(local.begin(), local.end(), ' ', '_');
+        uint8_t salt[16], hash[32];
+        for (size_t b = 0; b < sizeof(salt); ++b) salt[b] = (uint8_t)rng();
+        for (size_t b = 0; b < sizeof(hash); ++b) hash[b] = (uint8_t)rng();
+        records.push_back({"S" + to_string(100000 + i), first + " " + last, local + "@school.edu", to_string(17 + rng() % 10),
+                           PROGRAMS[rng() % 6], string(PASSWORD_SCHEME) + toHex(salt, sizeof(salt)) + "$" + toHex(hash, sizeof(hash))});
+    }
+    auto start = chrono::steady_clock::now();
+    StudentTable table;
+    table.reserve(n);
+    for (size_t i = 0; i < n; ++i) table.append(records[i]);
+    double buildSecs = secondsSince(start);
+
+    // Strings past the small-string buffer own a heap block of capacity + 1
+    size_t recordBytes = records.capacity() * sizeof(StudentRecord);
+    for (size_t i = 0; i < n; ++i) {
+        const string* fields[6] = {&records[i].id, &records[i].name, &records[i].email, &records[i].age, &records[i].program, &records[i].password};
+        for (int f = 0; f < 6; ++f)
+            if (fields[f]->capacity() > 15) recordBytes += fields[f]->capacity() + 1;
+    }
+
+    const string program = "bs it";
+    const int lo = 19, hi = 21;
+    const size_t rounds = 20;
+    size_t recordHits = 0, tableHits = 0;
+    start = chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r)
+        for (size_t i = 0; i < n; ++i) {
+            const StudentRecord& s = records[i];
+            int age = ageValue(s.age);
+            recordHits += compareFolded(trim(s.program), program) == 0 && age >= lo && age <= hi;
+        }
+    double recordSecs = secondsSince(start) / rounds;
+    start = chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        vector<char> programOk(table.programCount());
+        for (uint32_t p = 0; p < programOk.size(); ++p) programOk[p] = compareFolded(trim(table.programName(p)), program) == 0;
+        for (size_t i = 0; i < n; ++i) {
+            int age = table.age(i);
+            tableHits += programOk[table.programId(i)] && age >= lo && age <= hi;
+        }
+    }
+    double tableSecs = secondsSince(start) / rounds;
+
+    cout << fixed << setprecision(1);
+    cout << "  records: " << recordBytes / 1048576.0 << " MiB, scan " << recordSecs * 1e3 << " ms (" << recordHits / rounds << " hits)\n";
+    cout << "  table:   " << table.memoryBytes() / 1048576.0 << " MiB, scan " << tableSecs * 1e3 << " ms (" << tableHits / rounds
+         << " hits), built in " << buildSecs * 1e3 << " ms\n";
+}
+
+// Validation kernels: every kernel set is first fuzzed against the scalar
+// forms (the original loops), then timed on a column of n generated fields.
+// Returns false on any mismatch.
+bool benchValidate(size_t n) {
+    vector<TextKernels> sets = availableTextKernels();
+    const TextKernels& ref = sets[0];
+    // Bytes at and around every class boundary, plus a few past 0x7f
+    const string alphabet = string("@AZ[`az{/09: \t\x7f\x80\xff\xc3") + string(1, '\0') + "MmQq5";
+    mt19937 rng(23);
+    auto randomText = [&](size_t len) {
+        string t(len, ' ');
+        for (size_t i = 0; i < len; ++i) t[i] = rng() % 4 ? alphabet[rng() % alphabet.size()] : "aZ7 "[rng() % 4];
+        return t;
+    };
+    // Mostly in-class text, so the checks run to the end instead of failing at the first byte
+    auto classText = [&](size_t len, CharClass cls) {
+        static const char* members[3] = {"abcXYZ019", "abcXYZ ", "0123456789"};
+        string t(len, ' ');
+        for (size_t i = 0; i < len; ++i) t[i] = members[cls][rng() % strlen(members[cls])];
+        if (len && rng() % 3 == 0) t[rng() % len] = alphabet[rng() % alphabet.size()];
+        return t;
+    };
+    const size_t cases = 200000;
+    bool allOk = true;
+    cout << "Validation kernels (" << textKernels.name << " in use)\n";
+    for (size_t k = 1; k < sets.size(); ++k) {
+        size_t mismatches = 0;
+        for (size_t c = 0; c < cases; ++c) {
+            size_t len = rng() % 80;
+            CharClass cls = (CharClass)(rng() % 3);
+            string a = c % 2 ? randomText(len) : classText(len, cls);
+            if (sets[k].inClass(a.data(), a.size(), cls) != ref.inClass(a.data(), a.size(), cls)) ++mismatches;
+            // b: a with its case flipped here and there, sometimes with one byte changed
+            string b = a;
+            for (size_t i = 0; i < len; ++i)
+                if (rng() % 2 && isalpha((unsigned char)b[i])) b[i] ^= 0x20;
+            if (len && rng() % 2) b[rng() % len] = alphabet[rng() % alphabet.size()];
+            if (sets[k].equalFolded(a.data(), b.data(), len) != ref.equalFolded(a.data(), b.data(), len)) ++mismatches;
+        }
+        // Columns: views into one buffer, checked with and without the masked over-read
+        string buffer;
+        vector<size_t> at, lens;
+        for (size_t c = 0; c < 20000; ++c) {
+            CharClass cls = (CharClass)(c % 3);
+            string t = c % 2 ? randomText(rng() % 48) : classText(rng() % 48, cls);
+            at.push_back(buffer.size());
+            lens.push_back(t.size());
+            buffer += t;
+        }
+        vector<string_view> column;
+        for (size_t i = 0; i < at.size(); ++i) column.push_back(string_view(buffer.data() + at[i], lens[i]));
+        for (int cls = 0; cls < 3; ++cls) {
+            vector<char> want(column.size()), got(column.size()), gotMasked(column.size());
+            ref.classify(column.data(), 1, column.size(), (CharClass)cls, want.data(), nullptr);
+            sets[k].classify(column.data(), 1, column.size(), (CharClass)cls, got.data(), nullptr);
+            sets[k].classify(column.data(), 1, column.size(), (CharClass)cls, gotMasked.data(), buffer.data() + buffer.size());
+            for (size_t i = 0; i < column.size(); ++i) mismatches += (want[i] != got[i]) + (want[i] != gotMasked[i]);
+            // Every third value, as one column of a row-major field table
+            sets[k].classify(column.data(), 3, column.size() / 3, (CharClass)cls, got.data(), buffer.data() + buffer.size());
+            for (size_t i = 0; i < column.size() / 3; ++i) mismatches += want[i * 3] != got[i];
+        }
+        cout << "  fuzz " << sets[k].name << " vs scalar: " << cases << " strings, " << column.size() << " column values, "
+             << mismatches << " mismatches\n";
+        allOk = allOk && mismatches == 0;
+    }
+
+    // Throughput: names, 4-40 bytes, as an import column would hold them
+    string buffer;
+    vector<size_t> at, lens;
+    for (size_t i = 0; i < n; ++i) {
+        string name = string(FIRST[rng() % FIRST_COUNT]) + " " + LAST[rng() % LAST_COUNT];
+        if (rng() % 4 == 0) name += string(" ") + FIRST[rng() % FIRST_COUNT] + " " + LAST[rng() % LAST_COUNT];
+        at.push_back(buffer.size());
+        lens.push_back(name.size());
+        buffer += name;
+    }
+    vector<string_view> names;
+    for (size_t i = 0; i < n; ++i) names.push_back(string_view(buffer.data() + at[i], lens[i]));
+    vector<string> upper(n);
+    for (size_t i = 0; i < n; ++i) {
+        upper[i] = string(names[i]);
+        for (size_t j = 0; j < upper[i].size(); ++j) upper[i][j] = (char)toupper((unsigned char)upper[i][j]);
+    }
+    double mb = buffer.size() / 1048576.0;
+    cout << "  " << n << " names, " << fixed << setprecision(1) << mb << " MiB\n";
+    cout << "  " << left << setw(8) << "kernels" << right << setw(16) << "letters MiB/s" << setw(16) << "column MiB/s" << setw(16)
+         << "masked MiB/s" << setw(16) << "folded MiB/s" << "\n";
+    vector<char> ok(n);
+    const int rounds = 10;
+    for (size_t k = 0; k < sets.size(); ++k) {
+        size_t hits = 0;
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r)
+            for (size_t i = 0; i < n; ++i) hits += sets[k].inClass(names[i].data(), names[i].size(), CLASS_LETTERS);
+        double letters = secondsSince(start);
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) sets[k].classify(names.data(), 1, n, CLASS_LETTERS, ok.data(), nullptr);
+        double column = secondsSince(start);
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) sets[k].classify(names.data(), 1, n, CLASS_LETTERS, ok.data(), buffer.data() + buffer.size());
+        double masked = secondsSince(start);
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r)
+            for (size_t i = 0; i < n; ++i) hits += sets[k].equalFolded(names[i].data(), upper[i].data(), names[i].size());
+        double folded = secondsSince(start);
+        if (hits != 2 * rounds * n) allOk = false;
+        cout << "  " << left << setw(8) << sets[k].name << right << setw(16) << mb * rounds / letters << setw(16) << mb * rounds / column
+             << setw(16) << mb * rounds / masked << setw(16) << mb * rounds / folded << "\n";
+    }
+    if (!allOk) cout << "  KERNEL MISMATCH\n";
+    return allOk;
+}
+
+// Cold start from the text files vs from the snapshot, on a generated dataset
+void benchStartup(size_t n) {
+    size_t nc = max((size_t)10, n / 50), perStudent = 5;
+    cout << "Startup, " << n << " students, " << nc << " courses, " << n * perStudent << " enrollments\n";
+    filesystem::path home = filesystem::current_path(), dir = "bench_startup";
+    filesystem::create_directory(dir);
+    filesystem::current_path(dir);
+    {
+        ofstream sout("students.txt"), cout_("courses.txt"), eout("enrollments.txt");
+        for (size_t i = 0; i < nc; ++i)
+            RecordFiles::writeCourse(cout_, {"C" + to_string(1000 + i), "Bench Course " + to_string(i), "3", "0"});
+        for (size_t i = 0; i < n; ++i) {
+            string id = "S" + to_string(100000 + i);
+            RecordFiles::writeStudent(sout, {id, "Bench Student", id + "@school.edu", "20", "BS IT", "pw"});
+            for (size_t j = 0; j < perStudent; ++j)
+                RecordFiles::writeEnrollment(eout, {id, "C" + to_string(1000 + (i * 7 + j * 13) % nc)});
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    Registry* text = new Registry();
+    double textSecs = secondsSince(start);
+    size_t textEdges = text->enrollmentTotal();
+    start = chrono::steady_clock::now();
+    text->checkpoint();
+    double writeSecs = secondsSince(start);
+    delete text;
+
+    start = chrono::steady_clock::now();
+    Registry* snap = new Registry();
+    double snapSecs = secondsSince(start);
+    bool loaded = snap->snapshotCurrent && snap->enrollmentTotal() == textEdges;
+    delete snap;
+
+    filesystem::current_path(home);
+    filesystem::remove_all(dir);
+    cout << fixed << setprecision(1);
+    cout << "  text parse:     " << textSecs * 1e3 << " ms\n";
+    cout << "  snapshot write: " << writeSecs * 1e3 << " ms\n";
+    cout << "  snapshot load:  " << snapSecs * 1e3 << " ms" << (loaded ? "" : " (FAILED: fell back to text)") << "\n";
+}
+
+// Catching up with rows appended by another program, against reading the
+// files again; the cost should follow the number of rows appended
+bool benchTail(size_t n) {
+    size_t nc = max((size_t)10, n / 50);
+    cout << "Outside changes, " << n << " students, " << nc << " courses\n";
+    filesystem::path home = filesystem::current_path(), dir = "bench_tail";
+    filesystem::create_directory(dir);
+    filesystem::current_path(dir);
+    auto courseCode = [](size_t i) { return "C" + to_string(1000 + i); };
+    {
+        ofstream sout("students.txt"), cout_("courses.txt"), eout("enrollments.txt");
+        for (size_t i = 0; i < nc; ++i) RecordFiles::writeCourse(cout_, {courseCode(i), "Bench Course " + to_string(i), "3", "0"});
+        for (size_t i = 0; i < n; ++i) {
+            string id = "S" + to_string(100000 + i);
+            RecordFiles::writeStudent(sout, {id, "Bench Student", id + "@school.edu", "20", "BS IT", "pw"});
+            RecordFiles::writeEnrollment(eout, {id, courseCode(i % nc)});
+        }
+    }
+    auto start = chrono::steady_clock::now();
+    Registry* reg = new Registry();
+    double parseSecs = secondsSince(start);
+
+    bool ok = true;
+    cout << "  " << left << setw(22) << "change" << right << setw(10) << "rows" << setw(12) << "ms" << "\n";
+    cout << fixed << setprecision(3);
+    const size_t idle = 1000;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < idle; ++i) ok = reg->refreshSources().rows == 0 && ok;
+    cout << "  " << left << setw(22) << "none" << right << setw(10) << 0 << setw(12) << secondsSince(start) / idle * 1e3 << "\n";
+
+    size_t added = 0;
+    size_t batches[] = {1, 100, 10000};
+    for (size_t k : batches) {
+        {
+            ofstream sout("students.txt", ios::app), eout("enrollments.txt", ios::app);
+            for (size_t i = 0; i < k; ++i) {
+                string id = "X" + to_string(100000 + added + i);
+                RecordFiles::writeStudent(sout, {id, "Synced Student", id + "@school.edu", "19", "BS CS", "pw"});
+                RecordFiles::writeEnrollment(eout, {id, courseCode(i % nc)});
+            }
+        }
+        added += k;
+        start = chrono::steady_clock::now();
+        SourceRefresh r = reg->refreshSources();
+        double secs = secondsSince(start);
+        ok = ok && !r.reloaded && r.rows == 2 * k && reg->hasStudent("X" + to_string(100000 + added - 1));
+        cout << "  " << left << setw(22) << ("append " + to_string(k)) << right << setw(10) << r.rows << setw(12) << secs * 1e3 << "\n";
+    }
+
+    // Replaced the way other tools do it: a new file renamed over the old
+    {
+        string data = readWholeFile("students.txt");
+        ofstream out("students.new", ios::binary);
+        out << data << "Y100000,Replaced Student,y@school.edu,21,BS IT,pw\n";
+    }
+    replaceFile("students.new", "students.txt");
+    start = chrono::steady_clock::now();
+    SourceRefresh r = reg->refreshSources();
+    double secs = secondsSince(start);
+    ok = ok && r.reloaded && reg->hasStudent("Y100000") && reg->hasStudent("X" + to_string(100000 + added - 1)) &&
+         reg->enrollmentTotal() == n + added;
+    cout << "  " << left << setw(22) << "replace (reload)" << right << setw(10) << "-" << setw(12) << secs * 1e3 << "\n";
+    cout << "  " << left << setw(22) << "startup parse" << right << setw(10) << "-" << setw(12) << parseSecs * 1e3 << "\n";
+    delete reg;
+    filesystem::current_path(home);
+    filesystem::remove_all(dir);
+    cout << (ok ? "  registry matches the files\n" : "  FAILED: registry does not match the files\n");
+    return ok;
+}
+
+// Hot-path cost of Logger::log with several threads logging at once. Each
+// round is a burst that fits in the ring followed by a pause for the writer,
+// so this measures the enqueue rather than how fast the disk drains it.
+void benchLogger(size_t threads) {
+    const size_t rounds = 50, burst = 4096 / threads;
+    cout << "Logger, " << threads << " threads, " << rounds << " bursts of " << burst << " lines each\n";
+    string path = "bench_log.txt";
+    Logger* logger = new Logger(path, "bench_audit");
+    vector<double> busySecs(threads, 0.0);
+    for (size_t r = 0; r < rounds; ++r) {
+        vector<thread> pool;
+        for (size_t t = 0; t < threads; ++t) {
+            pool.push_back(thread([logger, t, burst, &busySecs]() {
+                string msg = "Student S" + to_string(100000 + t) + " enrolled in INTEPROG";
+                auto begin = chrono::steady_clock::now();
+                for (size_t i = 0; i < burst; ++i) logger->log(msg);
+                busySecs[t] += secondsSince(begin);
+            }));
+        }
+        for (size_t t = 0; t < threads; ++t) pool[t].join();
+        this_thread::sleep_for(chrono::milliseconds(20));
+    }
+    auto start = chrono::steady_clock::now();
+    delete logger;
+    double closeSecs = secondsSince(start);
+
+    size_t lines = 0;
+    {
+        ifstream fin(path.c_str());
+        string line;
+        while (getline(fin, line)) ++lines;
+    }
+    remove(path.c_str());
+    filesystem::remove_all("bench_audit");
+    double avg = 0;
+    for (size_t t = 0; t < threads; ++t) avg += busySecs[t] * 1e9 / (rounds * burst) / threads;
+    cout << fixed << setprecision(1);
+    cout << "  log() call:     " << avg << " ns avg\n";
+    cout << "  shutdown flush: " << closeSecs * 1e3 << " ms\n";
+    cout << "  lines written:  " << lines << " of " << threads * rounds * burst << "\n";
+}
+
+// Registration rush: every thread tries to enroll a different student in the
+// same course, whose cap is a quarter of the thread count. Checks that the
+// cap held exactly and shows what accepted and turned-away calls cost.
+bool benchSeats(size_t threads) {
+    size_t cap = max((size_t)1, threads / 4);
+    cout << "Seat reservation, " << threads << " threads, 1 course with " << cap << " seats\n";
+    filesystem::path home = filesystem::current_path(), dir = "bench_seats";
+    filesystem::create_directory(dir);
+    filesystem::current_path(dir);
+    {
+        ofstream sout("students.txt"), cout_("courses.txt");
+        RecordFiles::writeCourse(cout_, {"POPULAR", "Popular Course", "3", to_string(cap)});
+        for (size_t i = 0; i < threads; ++i) {
+            string id = "S" + to_string(100000 + i);
+            RecordFiles::writeStudent(sout, {id, "Bench Student", id + "@school.edu", "20", "BS IT", "pw"});
+        }
+    }
+    Registry* reg = new Registry();
+
+    // All threads are started first and released together
+    atomic<size_t> ready(0);
+    atomic<bool> go(false);
+    vector<EnrollResult> results(threads);
+    vector<double> callSecs(threads);
+    vector<thread> pool;
+    pool.reserve(threads);
+    for (size_t t = 0; t < threads; ++t) {
+        pool.push_back(thread([&, t]() {
+            string id = "S" + to_string(100000 + t);
+            ready.fetch_add(1);
+            while (!go.load(memory_order_acquire)) this_thread::yield();
+            auto begin = chrono::steady_clock::now();
+            results[t] = reg->enroll(id, "popular");
+            callSecs[t] = secondsSince(begin);
+        }));
+    }
+    while (ready.load() < threads) this_thread::yield();
+    auto start = chrono::steady_clock::now();
+    go.store(true, memory_order_release);
+    for (size_t t = 0; t < threads; ++t) pool[t].join();
+    double wallSecs = secondsSince(start);
+
+    size_t accepted = 0, full = 0;
+    double acceptedSecs = 0, fullSecs = 0;
+    for (size_t t = 0; t < threads; ++t) {
+        if (results[t] == ENROLL_OK) {
+            ++accepted;
+            acceptedSecs += callSecs[t];
+        } else if (results[t] == ENROLL_FULL) {
+            ++full;
+            fullSecs += callSecs[t];
+        }
+    }
+    size_t roster = reg->studentsIn("POPULAR").size();
+    delete reg;
+    filesystem::current_path(home);
+    filesystem::remove_all(dir);
+
+    cout << fixed << setprecision(1);
+    cout << "  wall time:      " << wallSecs * 1e3 << " ms\n";
+    cout << "  enrolled:       " << accepted << " (" << (accepted ? acceptedSecs * 1e6 / accepted : 0) << " us avg)\n";
+    cout << "  turned away:    " << full << " (" << (full ? fullSecs * 1e6 / full : 0) << " us avg)\n";
+    bool held = roster == cap && accepted == cap;
+    cout << "  roster size:    " << roster << (held ? " (cap held)" : " (MISMATCH)") << "\n";
+    return held;
+}
+
+// Concurrent writers: each thread edits its own students. Every edit is
+// acknowledged only once synced, so the entries per sync show how many
+// writers each group commit carried.
+void benchCommit(size_t maxThreads) {
+    const size_t students = 1000, edits = 4000;
+    cout << "Journal group commit, " << edits << " edits per run\n";
+    cout << "  " << setw(8) << "threads" << setw(12) << "edits/s" << setw(10) << "syncs" << setw(18) << "entries/sync\n";
+    filesystem::path home = filesystem::current_path(), dir = "bench_commit";
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        filesystem::create_directory(dir);
+        filesystem::current_path(dir);
+        {
+            ofstream sout("students.txt"), cout_("courses.txt");
+            for (size_t i = 0; i < students; ++i) {
+                string id = "S" + to_string(100000 + i);
+                RecordFiles::writeStudent(sout, {id, "Bench Student", id + "@school.edu", "20", "BS IT", "pw"});
+            }
+        }
+        Registry* reg = new Registry();
+        size_t syncsBefore = reg->journal.syncCount();
+        vector<thread> pool;
+        auto start = chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; ++t) {
+            pool.push_back(thread([reg, t, threads, edits = edits, students = students]() {
+                for (size_t i = t; i < edits; i += threads) {
+                    string id = "S" + to_string(100000 + (i % students));
+                    reg->updateStudent(StudentRecord{id, "Edited Student", id + "@school.edu", to_string(18 + i % 10), "BS IT", "pw"});
+                }
+            }));
+        }
+        for (size_t t = 0; t < threads; ++t) pool[t].join();
+        double secs = secondsSince(start);
+        size_t syncs = reg->journal.syncCount() - syncsBefore;
+        delete reg;
+        filesystem::current_path(home);
+        filesystem::remove_all(dir);
+        cout << "  " << setw(8) << threads << setw(12) << fixed << setprecision(0) << edits / secs << setw(10) << syncs
+             << setw(17) << setprecision(1) << (double)edits / max((size_t)1, syncs) << "\n";
+    }
+}
+
+// The per-request file scans the menus used to do, kept for comparison
+namespace legacy {
+bool login(const string& username, const string& password) {
+    ifstream fin("students.txt");
+    string line;
+    while (getline(fin, line)) {
+        istringstream iss(line);
+        string id, name, email, age, program, pwd;
+        getline(iss, id, ','); getline(iss, name, ','); getline(iss, email, ',');
+        getline(iss, age, ','); getline(iss, program, ','); getline(iss, pwd, ',');
+        if (equalsIgnoreCase(trim(id), trim(username)) && trim(pwd) == password) return true;
+    }
+    return false;
+}
+bool courseExists(const string& code) {
+    ifstream fin("courses.txt");
+    string line;
+    while (getline(fin, line)) {
+        istringstream iss(line);
+        string c;
+        getline(iss, c, ',');
+        if (equalsIgnoreCase(trim(c), trim(code))) return true;
+    }
+    return false;
+}
+bool enrolled(const string& sid, const string& code) {
+    ifstream fin("enrollments.txt");
+    string line;
+    while (getline(fin, line)) {
+        istringstream iss(line);
+        string id, c;
+        getline(iss, id, ','); getline(iss, c, ',');
+        if (equalsIgnoreCase(trim(id), trim(sid)) && equalsIgnoreCase(trim(c), trim(code))) return true;
+    }
+    return false;
+}
+bool enroll(const string& sid, const string& code) {
+    if (!courseExists(code) || enrolled(sid, code)) return false;
+    ofstream fout("enrollments.txt", ios::app);
+    fout << sid << "," << code << endl;
+    return true;
+}
+bool drop(const string& sid, const string& code) {
+    if (!courseExists(code) || !enrolled(sid, code)) return false;
+    ifstream fin("enrollments.txt");
+    ofstream fout("enrollments_tmp.txt");
+    string line;
+    while (getline(fin, line)) {
+        istringstream iss(line);
+        string id, c;
+        getline(iss, id, ','); getline(iss, c, ',');
+        if (!(equalsIgnoreCase(trim(id), trim(sid)) && equalsIgnoreCase(trim(c), trim(code))))
+            fout << id << "," << c << endl;
+    }
+    fin.close(); fout.close();
+    remove("enrollments.txt"); rename("enrollments_tmp.txt", "enrollments.txt");
+    return true;
+}
+size_t viewEnrolled(const string& sid) {
+    ifstream fin("enrollments.txt");
+    string line;
+    size_t found = 0;
+    while (getline(fin, line)) {
+        istringstream iss(line);
+        string id, code;
+        getline(iss, id, ','); getline(iss, code, ',');
+        if (trim(id) != sid) continue;
+        ifstream cfin("courses.txt");
+        string cline;
+        while (getline(cfin, cline)) {
+            istringstream ciss(cline);
+            string ccode;
+            getline(ciss, ccode, ',');
+            if (trim(ccode) == trim(code)) {
+                ++found;
+                break;
+            }
+        }
+    }
+    return found;
+}
+size_t roster(const string& code) {
+    ifstream fin("enrollments.txt");
+    string line;
+    size_t found = 0;
+    while (getline(fin, line)) {
+        istringstream iss(line);
+        string sid, ccode;
+        getline(iss, sid, ','); getline(iss, ccode, ',');
+        if (!equalsIgnoreCase(trim(ccode), trim(code))) continue;
+        ifstream sfin("students.txt");
+        string sline;
+        while (getline(sfin, sline)) {
+            istringstream siss(sline);
+            string id;
+            getline(siss, id, ',');
+            if (trim(id) == trim(sid)) {
+                ++found;
+                break;
+            }
+        }
+    }
+    return found;
+}
+}
+
+// Registration rush: a generated dataset, then threads issuing a mix of
+// login/enroll/drop/view/roster calls against the Registry, each one timed.
+// Up to 100k students the same calls are also timed against the old file
+// scans (a few samples each; beyond that a single roster scan takes minutes).
+enum RushOp { R_LOGIN, R_ENROLL, R_DROP, R_VIEW, R_ROSTER, R_OP_COUNT };
+const char* const RUSH_OP_NAMES[R_OP_COUNT] = {"login", "enroll", "drop", "view enrolled", "course roster"};
+// Share of the mix, in percent
+const unsigned RUSH_OP_WEIGHTS[R_OP_COUNT] = {20, 30, 15, 25, 10};
+
+void benchRush(size_t n, size_t ops, size_t threads) {
+    size_t nc = max((size_t)10, n / 50), perStudent = 3;
+    cout << "Registration rush, " << n << " students, " << nc << " courses, " << n * perStudent << " enrollments, "
+         << ops << " ops on " << threads << " threads\n";
+    filesystem::path home = filesystem::current_path(), dir = "bench_rush";
+    filesystem::create_directory(dir);
+    filesystem::current_path(dir);
+    auto studentId = [](size_t i) { return "S" + to_string(100000 + i); };
+    auto courseCode = [](size_t i) { return "C" + to_string(1000 + i); };
+    {
+        ofstream sout("students.txt"), cout_("courses.txt"), eout("enrollments.txt");
+        for (size_t i = 0; i < nc; ++i)
+            RecordFiles::writeCourse(cout_, {courseCode(i), "Bench Course " + to_string(i), "3", "0"});
+        for (size_t i = 0; i < n; ++i) {
+            RecordFiles::writeStudent(sout, {studentId(i), "Bench Student", studentId(i) + "@school.edu", "20", "BS IT", "pw"});
+            for (size_t j = 0; j < perStudent; ++j)
+                RecordFiles::writeEnrollment(eout, {studentId(i), courseCode((i * 7 + j * 13) % nc)});
+        }
+    }
+
+    // Legacy file scans first, while the files are still the generated ones
+    LatencySamples legacyLat[R_OP_COUNT];
+    bool legacyRun = n <= 100000;
+    if (legacyRun) {
+        const size_t samples = 20;
+        for (int op = 0; op < R_OP_COUNT; ++op) {
+            auto begin = chrono::steady_clock::now();
+            for (size_t k = 0; k < samples && secondsSince(begin) < 2.0; ++k) {
+                size_t i = (k * 7919) % n;
+                string sid = studentId(i), code = courseCode((i * 7 + 5) % nc);
+                auto t0 = chrono::steady_clock::now();
+                switch (op) {
+                    case R_LOGIN: legacy::login(sid, "pw"); break;
+                    case R_ENROLL: legacy::enroll(sid, code); break;
+                    case R_DROP: legacy::drop(sid, code); break;
+                    case R_VIEW: legacy::viewEnrolled(sid); break;
+                    case R_ROSTER: legacy::roster(code); break;
+                }
+                legacyLat[op].secs.push_back(secondsSince(t0));
+            }
+        }
+        // Put the generated files back for the Registry run
+        ofstream eout("enrollments.txt");
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = 0; j < perStudent; ++j)
+                RecordFiles::writeEnrollment(eout, {studentId(i), courseCode((i * 7 + j * 13) % nc)});
+    }
+
+    auto start = chrono::steady_clock::now();
+    Registry* reg = new Registry();
+    double loadSecs = secondsSince(start);
+
+    vector<LatencySamples> lat(threads * R_OP_COUNT);
+    atomic<size_t> failedLogins(0);
+    vector<thread> pool;
+    start = chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        pool.push_back(thread([&, t]() {
+            uint64_t rng = 0x9E3779B97F4A7C15ull * (t + 1);
+            auto next = [&rng]() {
+                rng ^= rng << 13;
+                rng ^= rng >> 7;
+                rng ^= rng << 17;
+                return rng;
+            };
+            size_t mine = ops / threads + (t < ops % threads ? 1 : 0);
+            for (size_t k = 0; k < mine; ++k) {
+                unsigned pick = (unsigned)(next() % 100), op = 0;
+                while (pick >= RUSH_OP_WEIGHTS[op]) pick -= RUSH_OP_WEIGHTS[op++];
+                size_t i = (size_t)(next() % n);
+                string sid = studentId(i), code = courseCode((size_t)(next() % nc));
+                StudentRecord s;
+                auto t0 = chrono::steady_clock::now();
+                switch (op) {
+                    case R_LOGIN:
+                        if (!reg->findStudent(sid, s) || s.password != "pw") failedLogins.fetch_add(1);
+                        break;
+                    case R_ENROLL: reg->enroll(sid, code); break;
+                    case R_DROP: reg->drop(sid, courseCode((i * 7 + (next() % perStudent) * 13) % nc)); break;
+                    case R_VIEW: reg->coursesOf(sid); break;
+                    case R_ROSTER: reg->studentsIn(code); break;
+                }
+                lat[t * R_OP_COUNT + op].secs.push_back(secondsSince(t0));
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads; ++t) pool[t].join();
+    double runSecs = secondsSince(start);
+    delete reg;
+    filesystem::current_path(home);
+    filesystem::remove_all(dir);
+
+    cout << fixed << setprecision(1);
+    cout << "  load: " << loadSecs * 1e3 << " ms, run: " << runSecs * 1e3 << " ms, " << setprecision(0)
+         << ops / runSecs << " ops/s" << (failedLogins ? " (LOGIN FAILURES: " + to_string(failedLogins) + ")" : "") << "\n";
+    cout << "  " << left << setw(15) << "op" << right << setw(8) << "count" << setw(12) << "p50 us" << setw(12) << "p99 us"
+         << setw(12) << "p999 us" << setw(16) << "legacy p50 us" << setw(10) << "speedup" << "\n";
+    for (int op = 0; op < R_OP_COUNT; ++op) {
+        LatencySamples all;
+        for (size_t t = 0; t < threads; ++t) all.merge(lat[t * R_OP_COUNT + op]);
+        size_t count = all.secs.size();
+        double p50 = all.percentile(0.50), p99 = all.percentile(0.99), p999 = all.percentile(0.999);
+        cout << "  " << left << setw(15) << RUSH_OP_NAMES[op] << right << setw(8) << count << setprecision(1)
+             << setw(12) << p50 * 1e6 << setw(12) << p99 * 1e6 << setw(12) << p999 * 1e6;
+        if (legacyRun && !legacyLat[op].secs.empty()) {
+            double legacyP50 = legacyLat[op].percentile(0.50);
+            cout << setw(16) << legacyP50 * 1e6 << setw(9) << setprecision(0) << (p50 > 0 ? legacyP50 / p50 : 0) << "x";
+        } else {
+            cout << setw(16) << "-" << setw(10) << "-";
+        }
+        cout << "\n";
+    }
+}
+
+// Output sink for benchmarks: formatting still runs, the bytes go nowhere
+class DiscardBuf : public streambuf {
+    char buf[4096];
+protected:
+    int overflow(int c) override {
+        setp(buf, buf + sizeof(buf));
+        return c == EOF ? 0 : c;
+    }
+};
+
+// Heap allocations per menu request, driven through the option handlers
+// with scripted input. The median is reported next to the mean because
+// the occasional request that triggers a checkpoint allocates far more.
+void benchAlloc(size_t rounds) {
+    const size_t n = 1000, nc = 40;
+    cout << "Menu requests, " << rounds << " rounds on " << n << " students and " << nc << " courses\n";
+    filesystem::path home = filesystem::current_path(), dir = "bench_alloc";
+    filesystem::create_directory(dir);
+    filesystem::current_path(dir);
+    auto studentId = [](size_t i) { return "S" + to_string(100000 + i); };
+    auto courseCode = [](size_t i) { return "C" + to_string(1000 + i); };
+    {
+        ofstream sout("students.txt"), cout_("courses.txt"), eout("enrollments.txt");
+        for (size_t i = 0; i < nc; ++i)
+            RecordFiles::writeCourse(cout_, {courseCode(i), "Introduction to Course " + to_string(i), "3", "0"});
+        for (size_t i = 0; i < n; ++i) {
+            RecordFiles::writeStudent(sout, {studentId(i), "Bench Student", studentId(i) + "@school.edu", "20", "BS Information Technology",
+                                             string(PASSWORD_SCHEME) + string(97, '0')});
+            for (size_t j = 0; j < 3; ++j) RecordFiles::writeEnrollment(eout, {studentId(i), courseCode((i * 7 + j * 13) % nc)});
+        }
+    }
+    Registry::getInstance();
+    StudentRecord me;
+    Registry::getInstance()->findStudent(studentId(0), me);
+    Student student(me.id, me.name, me.email, me.password);
+    Admin admin("admin", "Administrator", "admin@school.edu", "");
+
+    // Student 0 is in courses 0, 13 and 26; it enrolls in and drops one of the others each round
+    auto freeCourse = [&](size_t r) { return courseCode(1 + r % 12); };
+    struct Op {
+        const char* name;
+        User* user;
+        int option;
+        function<string(size_t)> input;
+    };
+    Op ops[] = {
+        {"view profile", &student, 1, [](size_t) { return string(); }},
+        {"enroll", &student, 2, [&](size_t r) { return freeCourse(r) + "\n"; }},
+        {"view enrolled", &student, 3, [](size_t) { return string(); }},
+        {"drop", &student, 5, [&](size_t r) { return freeCourse(r) + "\n"; }},
+        {"edit profile", &student, 4, [](size_t r) { return string(r % 2 ? "Bench Pupil" : "Bench Student") + "\n\n" + to_string(20 + r % 2) + "\n"; }},
+        {"edit student", &admin, 6, [&](size_t r) { return studentId(1 + r % (n - 1)) + "\n" + (r % 2 ? "Renamed Student" : "Bench Student") + "\n\n\n\n"; }},
+        {"course roster", &admin, 5, [&](size_t r) { return courseCode(r % nc) + "\n"; }},
+    };
+    const size_t opCount = sizeof(ops) / sizeof(ops[0]);
+    vector<unique_ptr<istringstream> > inputs;
+    for (size_t o = 0; o < opCount; ++o) {
+        string script;
+        for (size_t r = 0; r < rounds; ++r) script += ops[o].input(r);
+        inputs.emplace_back(new istringstream(script));
+    }
+    DiscardBuf discard;
+    ostream out(&discard);
+    sessionOut = &out;
+    vector<vector<uint64_t> > counts(opCount);
+    vector<double> secs(opCount);
+    for (size_t r = 0; r < rounds; ++r)
+        for (size_t o = 0; o < opCount; ++o) {
+            sessionIn = inputs[o].get();
+            uint64_t before = heapAllocations;
+            auto t0 = chrono::steady_clock::now();
+            ops[o].user->handleOption(ops[o].option);
+            secs[o] += secondsSince(t0);
+            counts[o].push_back(heapAllocations - before);
+        }
+    sessionIn = &cin;
+    sessionOut = &cout;
+    Registry::getInstance()->checkpoint();
+    filesystem::current_path(home);
+    filesystem::remove_all(dir);
+
+    cout << "  " << left << setw(15) << "request" << right << setw(14) << "allocs median" << setw(12) << "allocs mean" << setw(10) << "us"
+         << "\n";
+    for (size_t o = 0; o < opCount; ++o) {
+        uint64_t total = 0;
+        for (size_t r = 0; r < rounds; ++r) total += counts[o][r];
+        nth_element(counts[o].begin(), counts[o].begin() + rounds / 2, counts[o].end());
+        cout << "  " << left << setw(15) << ops[o].name << right << setw(14) << counts[o][rounds / 2] << fixed << setprecision(1)
+             << setw(12) << (double)total / rounds << setw(10) << secs[o] / rounds * 1e6 << "\n";
+    }
+}
+
+// Hot paths with metrics off and on; rounds alternate so drift hits both alike
+void benchMetrics(size_t n) {
+    const size_t nc = 40, lookups = 400000, requests = 40000, rounds = 25;
+    cout << "Metrics overhead on " << n << " students\n";
+    filesystem::path home = filesystem::current_path(), dir = "bench_metrics";
+    filesystem::create_directory(dir);
+    filesystem::current_path(dir);
+    auto studentId = [](size_t i) { return "S" + to_string(100000 + i); };
+    auto courseCode = [](size_t i) { return "C" + to_string(1000 + i); };
+    {
+        ofstream sout("students.txt"), cout_("courses.txt"), eout("enrollments.txt");
+        for (size_t i = 0; i < nc; ++i)
+            RecordFiles::writeCourse(cout_, {courseCode(i), "Introduction to Course " + to_string(i), "3", "0"});
+        for (size_t i = 0; i < n; ++i) {
+            RecordFiles::writeStudent(sout, {studentId(i), "Bench Student", studentId(i) + "@school.edu", "20", "BS Information Technology",
+                                             string(PASSWORD_SCHEME) + string(97, '0')});
+            for (size_t j = 0; j < 3; ++j) RecordFiles::writeEnrollment(eout, {studentId(i), courseCode((i * 7 + j * 13) % nc)});
+        }
+    }
+    Registry* reg = Registry::getInstance();
+    vector<string> ids;
+    mt19937 rng(7);
+    for (size_t i = 0; i < 4096; ++i) ids.push_back(studentId(rng() % n));
+    StudentRecord me;
+    reg->findStudent(studentId(0), me);
+    Student student(me.id, me.name, me.email, me.password);
+    DiscardBuf discard;
+    ostream out(&discard);
+    sessionOut = &out;
+
+    struct Case {
+        const char* name;
+        size_t calls;
+        function<void(size_t)> run;
+    };
+    size_t hits = 0;
+    Case cases[] = {
+        {"index lookup", lookups, [&](size_t k) {
+             for (size_t i = 0; i < k; ++i) hits += reg->hasStudent(ids[i & 4095]);
+         }},
+        {"view profile", requests, [&](size_t k) {
+             for (size_t i = 0; i < k; ++i) student.handleOption(1);
+         }},
+        {"view enrolled", requests, [&](size_t k) {
+             for (size_t i = 0; i < k; ++i) student.handleOption(3);
+         }},
+        // The timer alone, on a scope with nothing in it
+        {"empty scope", lookups, [&](size_t k) {
+             for (size_t i = 0; i < k; ++i) {
+                 MetricTimer timer(M_SCAN);
+                 asm volatile("" ::: "memory");
+             }
+         }},
+    };
+    cout << "  " << left << setw(15) << "operation" << right << setw(10) << "off ns" << setw(10) << "on ns" << setw(12) << "overhead"
+         << "\n";
+    for (Case& c : cases) {
+        double best[2] = {1e30, 1e30};
+        c.run(c.calls / 10);
+        for (size_t r = 0; r < rounds; ++r)
+            for (int on = 0; on < 2; ++on) {
+                Metrics::enabled.store(on == 1);
+                auto t0 = chrono::steady_clock::now();
+                c.run(c.calls);
+                best[on] = min(best[on], secondsSince(t0) / c.calls * 1e9);
+            }
+        cout << "  " << left << setw(15) << c.name << right << fixed << setprecision(1) << setw(10) << best[0] << setw(10) << best[1];
+        // The empty scope's cost is the whole difference, not a share of anything
+        if (&c == &cases[3]) cout << setw(9) << best[1] - best[0] << " ns\n";
+        else cout << setw(11) << (best[1] / best[0] - 1) * 100 << "%\n";
+    }
+    Metrics::enabled.store(true);
+    sessionOut = &cout;
+    reg->checkpoint();
+    Metrics::getInstance()->writeFile("metrics.prom");
+    filesystem::current_path(home);
+    cout << "  (" << hits << " lookups hit; histograms in " << (dir / "metrics.prom").string() << ")\n";
+}
+
+int runBenchmark(const string& name, size_t size) {
+    if (name == "index") {
+        benchIndex(size ? size : 200000);
+        return 0;
+    }
+    if (name == "log") {
+        benchLogger(size ? size : 4);
+        return 0;
+    }
+    if (name == "startup") {
+        benchStartup(size ? size : 1000000);
+        return 0;
+    }
+    if (name == "rush") {
+        size_t threads = max(4u, thread::hardware_concurrency());
+        if (size) {
+            benchRush(size, 20000, threads);
+        } else {
+            benchRush(10000, 20000, threads);
+            benchRush(100000, 20000, threads);
+            benchRush(1000000, 20000, threads);
+        }
+        return 0;
+    }
+    if (name == "search") {
+        benchSearch(size ? size : 1000000);
+        return 0;
+    }
+    if (name == "tail") return benchTail(size ? size : 200000) ? 0 : 1;
+    if (name == "table") {
+        benchTable(size ? size : 1000000);
+        return 0;
+    }
+    if (name == "validate") return benchValidate(size ? size : 1000000) ? 0 : 1;
+    if (name == "alloc") {
+        benchAlloc(size ? size : 1000);
+        return 0;
+    }
+    if (name == "metrics") {
+        benchMetrics(size ? size : 100000);
+        return 0;
+    }
+    if (name == "commit") {
+        benchCommit(size ? size : 32);
+        return 0;
+    }
+    if (name == "seats") return benchSeats(size ? size : 4000) ? 0 : 1;
+    cerr << "Unknown benchmark: " << name << "\n";
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: sms_bench index|log|startup|rush|search|tail|table|validate|alloc|metrics|commit|seats [size]\n";
+        return 1;
+    }
+    return runBenchmark(argv[1], argc >= 3 ? strtoul(argv[2], nullptr, 10) : 0);
+}
@@ -0,0 +1,4680 @@
+// Student Management System: the definitions behind sms.h, built once as
+// the sms_core library that sms and sms_bench link.
+#include "sms.h"
+
+string trim(const string& s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return (start == string::npos) ? "" : s.substr(start, end - start + 1);
+}
+string foldCase(string_view s) {
+    string r(s);
+    for (size_t i = 0; i < r.size(); ++i)
+        if (r[i] >= 'A' && r[i] <= 'Z') r[i] += 32;
+    return r;
+}
+
+// --- Text kernels: character classes and case-blind compares ---
+bool inClassScalar(const char* p, size_t n, CharClass cls) {
+    for (size_t i = 0; i < n; ++i) {
+        char c = p[i];
+        bool letter = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'), digit = c >= '0' && c <= '9';
+        if (!(cls == CLASS_ALNUM ? letter || digit : cls == CLASS_LETTERS ? letter || c == ' ' : digit)) return false;
+    }
+    return true;
+}
+bool equalFoldedScalar(const char* a, const char* b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        char ca = a[i], cb = b[i];
+        if (ca >= 'A' && ca <= 'Z') ca += 32;
+        if (cb >= 'A' && cb <= 'Z') cb += 32;
+        if (ca != cb) return false;
+    }
+    return true;
+}
+void classifyScalar(const string_view* v, size_t stride, size_t n, CharClass cls, char* ok, const char*) {
+    for (size_t i = 0; i < n; ++i, v += stride) ok[i] = !v->empty() && inClassScalar(v->data(), v->size(), cls);
+}
+#if defined(__SSE2__) || defined(_M_X64)
+bool inClassSse2(const char* p, size_t n, CharClass cls) {
+    if (n < 16) return inClassScalar(p, n, cls);
+    for (size_t i = 0; i + 16 <= n; i += 16)
+        if (classMask16(_mm_loadu_si128((const __m128i*)(p + i)), cls) != 0xffff) return false;
+    return n % 16 == 0 || classMask16(_mm_loadu_si128((const __m128i*)(p + n - 16)), cls) == 0xffff;
+}
+bool equalFoldedSse2(const char* a, const char* b, size_t n) {
+    if (n < 16) return equalFoldedScalar(a, b, n);
+    for (size_t i = 0;; i += 16) {
+        if (i + 16 > n) i = n - 16;
+        __m128i x = fold16(_mm_loadu_si128((const __m128i*)(a + i))), y = fold16(_mm_loadu_si128((const __m128i*)(b + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff) return false;
+        if (i + 16 == n) return true;
+    }
+}
+void classifySse2(const string_view* v, size_t stride, size_t n, CharClass cls, char* ok, const char* readLimit) {
+    for (size_t i = 0; i < n; ++i, v += stride) {
+        size_t len = v->size();
+        const char* p = v->data();
+        if (len && len <= 16 && readLimit && p + 16 <= readLimit) {
+            unsigned want = (1u << len) - 1;
+            ok[i] = (classMask16(_mm_loadu_si128((const __m128i*)p), cls) & want) == want;
+        } else {
+            ok[i] = len && inClassSse2(p, len, cls);
+        }
+    }
+}
+#endif
+#ifdef HAVE_RUNTIME_AVX2
+AVX2_KERNEL bool inClassAvx2(const char* p, size_t n, CharClass cls) {
+    if (n < 32) return inClassSse2(p, n, cls);
+    for (size_t i = 0; i + 32 <= n; i += 32)
+        if (classMask32(_mm256_loadu_si256((const __m256i*)(p + i)), cls) != 0xffffffffu) return false;
+    return n % 32 == 0 || classMask32(_mm256_loadu_si256((const __m256i*)(p + n - 32)), cls) == 0xffffffffu;
+}
+AVX2_KERNEL bool equalFoldedAvx2(const char* a, const char* b, size_t n) {
+    if (n < 32) return equalFoldedSse2(a, b, n);
+    for (size_t i = 0;; i += 32) {
+        if (i + 32 > n) i = n - 32;
+        __m256i x = fold32(_mm256_loadu_si256((const __m256i*)(a + i))), y = fold32(_mm256_loadu_si256((const __m256i*)(b + i)));
+        if ((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != 0xffffffffu) return false;
+        if (i + 32 == n) return true;
+    }
+}
+AVX2_KERNEL void classifyAvx2(const string_view* v, size_t stride, size_t n, CharClass cls, char* ok, const char* readLimit) {
+    for (size_t i = 0; i < n; ++i, v += stride) {
+        size_t len = v->size();
+        const char* p = v->data();
+        if (len && len <= 32 && readLimit && p + 32 <= readLimit) {
+            unsigned want = len == 32 ? 0xffffffffu : (1u << len) - 1;
+            ok[i] = (classMask32(_mm256_loadu_si256((const __m256i*)p), cls) & want) == want;
+        } else {
+            ok[i] = len && inClassAvx2(p, len, cls);
+        }
+    }
+}
+#endif
+vector<TextKernels> availableTextKernels() {
+    vector<TextKernels> sets;
+    sets.push_back({"scalar", inClassScalar, equalFoldedScalar, classifyScalar});
+#if defined(__SSE2__) || defined(_M_X64)
+    sets.push_back({"sse2", inClassSse2, equalFoldedSse2, classifySse2});
+#endif
+#ifdef HAVE_RUNTIME_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) sets.push_back({"avx2", inClassAvx2, equalFoldedAvx2, classifyAvx2});
+#endif
+    return sets;
+}
+const TextKernels textKernels = availableTextKernels().back();
+bool equalsIgnoreCase(string_view a, string_view b) {
+    return a.size() == b.size() && textKernels.equalFolded(a.data(), b.data(), a.size());
+}
+void classifyColumn(const string_view* first, size_t stride, size_t n, CharClass cls, char* ok, const char* readLimit) {
+    textKernels.classify(first, stride, n, cls, ok, readLimit);
+}
+
+// --- Open-addressing hash index on case-folded keys ---
+uint32_t hashFolded(string_view s) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 'A' && c <= 'Z') c += 32;
+        h = (h ^ c) * 16777619u;
+    }
+    return h;
+}
+void FoldedKeyIndex::place(const Bucket& b) {
+    size_t i = b.hash & mask();
+    while (table[i].slot != EMPTY) i = (i + 1) & mask();
+    table[i] = b;
+}
+void FoldedKeyIndex::rehash(size_t capacity) {
+    vector<Bucket> old;
+    old.swap(table);
+    table.assign(capacity, Bucket{0, EMPTY});
+    for (size_t i = 0; i < old.size(); ++i)
+        if (old[i].slot != EMPTY) place(old[i]);
+}
+void FoldedKeyIndex::clear() {
+    table.assign(16, Bucket{0, EMPTY});
+    count = 0;
+}
+void FoldedKeyIndex::reserve(size_t n) {
+    size_t capacity = table.size();
+    while (capacity * 3 < n * 4) capacity *= 2;
+    if (capacity != table.size()) rehash(capacity);
+}
+bool FoldedKeyIndex::adopt(const Bucket* b, size_t capacity, size_t n, size_t rows) {
+    if (capacity < 16 || (capacity & (capacity - 1)) != 0 || n * 4 > capacity * 3) return false;
+    size_t used = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+        if (b[i].slot == EMPTY) continue;
+        if (b[i].slot >= rows) return false;
+        ++used;
+    }
+    if (used != n) return false;
+    table.assign(b, b + capacity);
+    count = n;
+    return true;
+}
+void FoldedKeyIndex::insert(string_view key, uint32_t slot) {
+    if ((count + 1) * 4 > table.size() * 3) rehash(table.size() * 2);
+    place(Bucket{hashFolded(key), slot});
+    ++count;
+}
+bool FoldedKeyIndex::erase(string_view key, uint32_t slot) {
+    size_t i = hashFolded(key) & mask();
+    while (table[i].slot != slot) {
+        if (table[i].slot == EMPTY) return false;
+        i = (i + 1) & mask();
+    }
+    // Shift later members of the probe run back into the hole
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask();
+        if (table[j].slot == EMPTY) break;
+        size_t home = table[j].hash & mask();
+        bool between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (between) continue;
+        table[i] = table[j];
+        i = j;
+    }
+    table[i].slot = EMPTY;
+    --count;
+    return true;
+}
+
+// --- Text index: typo-tolerant prefix search over short texts ---
+void TextIndex::wordsOf(string_view text, vector<string>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !wordChar(text[i])) ++i;
+        size_t start = i;
+        while (i < text.size() && wordChar(text[i]) && isDigit(text[i]) == isDigit(text[start])) ++i;
+        if (start < i) out.push_back(foldCase(string(text.substr(start, i - start))));
+    }
+}
+void TextIndex::gramsOf(const string& word, bool prefix, vector<uint32_t>& out) {
+    out.clear();
+    uint32_t g = (' ' << 8) | ' ';
+    for (size_t i = 0; i < word.size(); ++i) {
+        g = ((g << 8) | (unsigned char)word[i]) & 0xffffff;
+        out.push_back(g);
+    }
+    if (!prefix) out.push_back(((g << 8) | ' ') & 0xffffff);
+    sort(out.begin(), out.end());
+    out.erase(unique(out.begin(), out.end()), out.end());
+}
+int TextIndex::typoBudget(const string& word) {
+    if (word.empty() || isDigit(word[0])) return 0;
+    return word.size() < 4 ? 0 : word.size() < 8 ? 1 : 2;
+}
+int TextIndex::distance(string_view a, string_view b, int max, bool prefix) {
+    size_t n = a.size(), m = b.size();
+    if (prefix && m > n + max) m = n + max;
+    if (n > MAX_FUZZY_LENGTH || m > MAX_FUZZY_LENGTH) return a == b.substr(0, prefix ? n : m) ? 0 : max + 1;
+    if (!prefix && (n > m ? n - m : m - n) > (size_t)max) return max + 1;
+    int rows[3][MAX_FUZZY_LENGTH + 1];
+    int *before = rows[0], *above = rows[1], *row = rows[2];
+    for (size_t j = 0; j <= m; ++j) above[j] = (int)j;
+    for (size_t i = 1; i <= n; ++i) {
+        row[0] = (int)i;
+        int best = row[0];
+        for (size_t j = 1; j <= m; ++j) {
+            row[j] = min(min(above[j], row[j - 1]) + 1, above[j - 1] + (a[i - 1] != b[j - 1]));
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) row[j] = min(row[j], before[j - 2] + 1);
+            best = min(best, row[j]);
+        }
+        if (best > max) return max + 1;
+        swap(before, above);
+        swap(above, row);
+    }
+    int d = prefix ? *min_element(above, above + m + 1) : above[m];
+    return min(d, max + 1);
+}
+size_t TextIndex::seek(const vector<uint32_t>& list, size_t from, uint32_t slot) {
+    if (from >= list.size() || list[from] >= slot) return from;
+    size_t step = 1;
+    while (from + step < list.size() && list[from + step] < slot) step *= 2;
+    return lower_bound(list.begin() + from + step / 2 + 1, list.begin() + min(from + step + 1, list.size()), slot) - list.begin();
+}
+uint32_t TextIndex::wordId(const string& word, bool keepSorted) {
+    auto it = wordIds.find(word);
+    if (it != wordIds.end()) return it->second;
+    uint32_t id = (uint32_t)words.size();
+    words.push_back(word);
+    wordIds.emplace(word, id);
+    wordSlots.push_back(vector<uint32_t>());
+    if (!isDigit(word[0])) {
+        vector<uint32_t> grams;
+        gramsOf(word, false, grams);
+        for (size_t i = 0; i < grams.size(); ++i) gramWords[grams[i]].push_back(id);
+    }
+    if (keepSorted) sortedWords.insert(upper_bound(sortedWords.begin(), sortedWords.end(), word, [this](const string& w, uint32_t b) { return w < words[b]; }), id);
+    else sortedWords.push_back(id);
+    return id;
+}
+void TextIndex::add(uint32_t slot, string_view text, bool keepSorted) {
+    vector<string> found;
+    wordsOf(text, found);
+    if (slotWords.size() <= slot) slotWords.resize(slot + 1);
+    vector<uint32_t>& mine = slotWords[slot];
+    for (size_t i = 0; i < found.size(); ++i) mine.push_back(wordId(found[i], keepSorted));
+    sort(mine.begin(), mine.end());
+    mine.erase(unique(mine.begin(), mine.end()), mine.end());
+    for (size_t i = 0; i < mine.size(); ++i) {
+        vector<uint32_t>& list = wordSlots[mine[i]];
+        // New slots come last, so this is nearly always an append
+        if (list.empty() || list.back() < slot) list.push_back(slot);
+        else list.insert(lower_bound(list.begin(), list.end(), slot), slot);
+    }
+}
+void TextIndex::matchWord(const string& q, bool prefix, unordered_map<uint32_t, int>& out) const {
+    out.clear();
+    int budget = typoBudget(q);
+    if (budget == 0) {
+        if (!prefix) {
+            auto it = wordIds.find(q);
+            if (it != wordIds.end()) out[it->second] = 0;
+            return;
+        }
+        auto it = lower_bound(sortedWords.begin(), sortedWords.end(), q, [this](uint32_t a, const string& w) { return words[a] < w; });
+        for (size_t n = 0; it != sortedWords.end() && n < MAX_PREFIX_WORDS; ++it, ++n) {
+            if (words[*it].compare(0, q.size(), q) != 0) break;
+            out[*it] = 0;
+        }
+        return;
+    }
+    // A typo spoils up to four grams (a swap does), so a match keeps at
+    // least `need` of them and turns up in one of the shortest
+    // grams-need+1 lists: merge those and probe the longer ones
+    vector<uint32_t> grams;
+    gramsOf(q, prefix, grams);
+    size_t need = grams.size() > 4 * (size_t)budget ? grams.size() - 4 * budget : 1;
+    static const vector<uint32_t> none;
+    vector<const vector<uint32_t>*> lists;
+    for (size_t i = 0; i < grams.size(); ++i) {
+        auto it = gramWords.find(grams[i]);
+        lists.push_back(it == gramWords.end() ? &none : &it->second);
+    }
+    sort(lists.begin(), lists.end(), [](const vector<uint32_t>* a, const vector<uint32_t>* b) { return a->size() < b->size(); });
+    size_t merged = grams.size() - need + 1;
+    vector<uint32_t> candidates;
+    for (size_t i = 0; i < merged; ++i) candidates.insert(candidates.end(), lists[i]->begin(), lists[i]->end());
+    sort(candidates.begin(), candidates.end());
+    vector<size_t> at(lists.size(), 0);
+    for (size_t c = 0; c < candidates.size();) {
+        uint32_t id = candidates[c];
+        size_t shared = 0;
+        for (; c < candidates.size() && candidates[c] == id; ++c) ++shared;
+        for (size_t i = merged; i < lists.size() && shared < need && shared + (lists.size() - i) >= need; ++i) {
+            const vector<uint32_t>& list = *lists[i];
+            at[i] = lower_bound(list.begin() + at[i], list.end(), id) - list.begin();
+            if (at[i] < list.size() && list[at[i]] == id) ++shared;
+        }
+        if (shared < need || wordSlots[id].empty()) continue;
+        int d = distance(q, words[id], budget, prefix);
+        if (d <= budget) out[id] = d;
+    }
+}
+void TextIndex::clear() {
+    words.clear();
+    wordIds.clear();
+    wordSlots.clear();
+    sortedWords.clear();
+    gramWords.clear();
+    slotWords.clear();
+}
+void TextIndex::erase(uint32_t slot) {
+    if (slot >= slotWords.size()) return;
+    vector<uint32_t>& mine = slotWords[slot];
+    for (size_t i = 0; i < mine.size(); ++i) {
+        vector<uint32_t>& list = wordSlots[mine[i]];
+        auto at = lower_bound(list.begin(), list.end(), slot);
+        if (at != list.end() && *at == slot) list.erase(at);
+    }
+    vector<uint32_t>().swap(mine);
+}
+vector<TextIndex::Hit> TextIndex::search(string_view query, size_t k) const {
+    vector<Hit> hits;
+    vector<string> q;
+    wordsOf(query, q);
+    if (q.empty() || k == 0) return hits;
+    vector<unordered_map<uint32_t, int> > matched(q.size());
+    bool lastIsPrefix = wordChar(query.back());
+    int maxTier = 0;
+    for (size_t j = 0; j < q.size(); ++j) {
+        matchWord(q[j], lastIsPrefix && j + 1 == q.size(), matched[j]);
+        if (matched[j].empty()) return hits;
+        maxTier = max(maxTier, typoBudget(q[j]));
+    }
+    for (int tier = 0; tier <= maxTier && hits.size() < k; ++tier) {
+        // A tier that admits no new words would only repeat the last one
+        if (tier > 0 && !widens(matched, tier)) continue;
+        Tier t(matched, tier);
+        candidates(t);
+        collect(t, k, hits);
+    }
+    return hits;
+}
+bool TextIndex::widens(const vector<unordered_map<uint32_t, int> >& matched, int tier) {
+    for (size_t j = 0; j < matched.size(); ++j)
+        for (auto it = matched[j].begin(); it != matched[j].end(); ++it)
+            if (it->second == tier) return true;
+    return false;
+}
+void TextIndex::candidates(Tier& t) const {
+    size_t n = t.matched.size(), driverSize = SIZE_MAX;
+    t.postings.resize(n);
+    t.sizes.assign(n, 0);
+    t.at.resize(n);
+    for (size_t j = 0; j < n; ++j) {
+        for (auto it = t.matched[j].begin(); it != t.matched[j].end(); ++it) {
+            const vector<uint32_t>& list = wordSlots[it->first];
+            if (it->second > t.typos || list.empty()) continue;
+            t.postings[j].push_back(Posting(&list, it->second));
+            t.sizes[j] += list.size();
+        }
+        t.at[j].assign(t.postings[j].size(), 0);
+        if (t.sizes[j] < driverSize) {
+            t.driver = j;
+            driverSize = t.sizes[j];
+        }
+    }
+    t.order.resize(n);
+    for (size_t j = 0; j < n; ++j) t.order[j] = j;
+    const vector<size_t>& sizes = t.sizes;
+    sort(t.order.begin(), t.order.end(), [&sizes](size_t a, size_t b) { return sizes[a] < sizes[b]; });
+}
+int TextIndex::score(Tier& t, uint32_t slot, int driverTypos, uint32_t& skipTo) const {
+    int typos = 0;
+    skipTo = 0;
+    for (size_t o = 0; o < t.order.size(); ++o) {
+        size_t j = t.order[o];
+        int best = INT_MAX;
+        if (j == t.driver) {
+            best = driverTypos;
+        } else if (t.postings[j].size() <= PROBED_LISTS) {
+            uint32_t next = UINT32_MAX;
+            for (size_t p = 0; p < t.postings[j].size(); ++p) {
+                const vector<uint32_t>& list = *t.postings[j][p].first;
+                size_t& from = t.at[j][p];
+                from = seek(list, from, slot);
+                if (from == list.size()) continue;
+                if (list[from] == slot) best = min(best, t.postings[j][p].second);
+                else next = min(next, list[from]);
+            }
+            if (best > t.typos) skipTo = next;
+        } else {
+            const vector<uint32_t>& mine = slotWords[slot];
+            for (size_t w = 0; w < mine.size(); ++w) {
+                auto it = t.matched[j].find(mine[w]);
+                if (it != t.matched[j].end() && it->second <= t.typos) best = min(best, it->second);
+            }
+        }
+        if (best > t.typos) return -1;
+        typos += best;
+    }
+    return typos;
+}
+void TextIndex::collect(Tier& t, size_t k, vector<Hit>& hits) const {
+    typedef pair<uint32_t, size_t> Head;
+    const vector<Posting>& lists = t.postings[t.driver];
+    vector<size_t>& at = t.at[t.driver];
+    priority_queue<Head, vector<Head>, greater<Head> > heads;
+    for (size_t i = 0; i < lists.size(); ++i) heads.push(Head((*lists[i].first)[0], i));
+    while (!heads.empty() && hits.size() < k) {
+        uint32_t slot = heads.top().first;
+        int driverTypos = INT_MAX;
+        while (!heads.empty() && heads.top().first == slot) {
+            size_t i = heads.top().second;
+            heads.pop();
+            driverTypos = min(driverTypos, lists[i].second);
+            if (++at[i] < lists[i].first->size()) heads.push(Head((*lists[i].first)[at[i]], i));
+        }
+        uint32_t skipTo;
+        int typos = score(t, slot, driverTypos, skipTo);
+        if (typos < 0) {
+            if (skipTo == UINT32_MAX) break;
+            while (!heads.empty() && heads.top().first < skipTo) {
+                size_t i = heads.top().second;
+                heads.pop();
+                at[i] = seek(*lists[i].first, at[i], skipTo);
+                if (at[i] < lists[i].first->size()) heads.push(Head((*lists[i].first)[at[i]], i));
+            }
+            continue;
+        }
+        bool seen = false;
+        for (size_t h = 0; h < hits.size(); ++h) seen = seen || hits[h].slot == slot;
+        if (!seen) hits.push_back({slot, typos});
+    }
+}
+
+// --- CSV tokenizer: splits text into string_view fields without copying ---
+const char* findByte(const char* p, const char* end, char c) {
+#if defined(__AVX2__)
+    const __m256i needle = _mm256_set1_epi8(c);
+    for (; end - p >= 32; p += 32) {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), needle));
+        if (mask) return p + lowestBit(mask);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i needle = _mm_set1_epi8(c);
+    for (; end - p >= 16; p += 16) {
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), needle));
+        if (mask) return p + lowestBit(mask);
+    }
+#endif
+    for (; p < end; ++p)
+        if (*p == c) return p;
+    return end;
+}
+string_view trimView(string_view s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == string_view::npos) return string_view();
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, end - start + 1);
+}
+size_t splitLine(string_view line, string_view* fields, size_t n) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    size_t found = 0;
+    while (found < n) {
+        const char* comma = findByte(p, end, ',');
+        fields[found++] = trimView(string_view(p, (size_t)(comma - p)));
+        if (comma == end) break;
+        p = comma + 1;
+    }
+    for (size_t i = found; i < n; ++i) fields[i] = string_view();
+    return found;
+}
+string readWholeFile(const char* path) {
+    string data;
+    ifstream fin(path, ios::binary);
+    if (!fin) return data;
+    fin.seekg(0, ios::end);
+    streamoff size = fin.tellg();
+    fin.seekg(0, ios::beg);
+    if (size > 0) {
+        data.resize((size_t)size);
+        fin.read(&data[0], size);
+        data.resize((size_t)fin.gcount());
+    }
+    return data;
+}
+string readFileRange(const char* path, uint64_t from, uint64_t n) {
+    string data;
+    ifstream fin(path, ios::binary);
+    if (!fin || !n || !fin.seekg((streamoff)from)) return data;
+    data.resize((size_t)n);
+    fin.read(&data[0], (streamsize)n);
+    data.resize((size_t)fin.gcount());
+    return data;
+}
+
+// --- Audit log: fixed-layout binary events in rotated, indexed segments ---
+string auditField(const char* f) { return string(f, strnlen(f, AUDIT_ID_LEN)); }
+void setAuditField(char* f, string_view s) {
+    memset(f, 0, AUDIT_ID_LEN);
+    memcpy(f, s.data(), min(s.size(), AUDIT_ID_LEN));
+}
+string describeEvent(int action, const string& actor, const string& target) {
+    bool admin = actor == "admin";
+    switch (action) {
+        case A_LOGIN: return admin ? "Admin logged in" : "Student " + actor + " logged in";
+        case A_LOGOUT: return admin ? "Admin logged out" : actor + " logged out";
+        case A_ADD_STUDENT: return "Admin added student " + target;
+        case A_ADD_COURSE: return "Admin added course " + target;
+        case A_EDIT_STUDENT: return "Admin edited student " + target;
+        case A_EDIT_COURSE: return "Admin edited course " + target;
+        case A_DELETE_STUDENT: return "Admin deleted student " + target;
+        case A_DELETE_COURSE: return "Admin deleted course " + target;
+        case A_ENROLL: return "Student " + actor + " enrolled in " + target;
+        case A_DROP: return "Student " + actor + " dropped course " + target;
+        case A_EDIT_PROFILE: return "Student " + actor + " edited profile";
+    }
+    return target;
+}
+void bloomAdd(uint8_t* bloom, const string& key) {
+    uint32_t h1 = hashFolded(key), h2 = (h1 >> 16 | h1 << 16) * 0x9e3779b1u | 1;
+    for (uint32_t i = 0; i < 3; ++i) {
+        uint32_t bit = (h1 + i * h2) % (AUDIT_BLOOM_BYTES * 8);
+        bloom[bit / 8] |= (uint8_t)(1 << (bit % 8));
+    }
+}
+bool bloomMayContain(const uint8_t* bloom, const string& key) {
+    uint32_t h1 = hashFolded(key), h2 = (h1 >> 16 | h1 << 16) * 0x9e3779b1u | 1;
+    for (uint32_t i = 0; i < 3; ++i) {
+        uint32_t bit = (h1 + i * h2) % (AUDIT_BLOOM_BYTES * 8);
+        if (!(bloom[bit / 8] & (1 << (bit % 8)))) return false;
+    }
+    return true;
+}
+string auditSegmentPath(const string& dir, uint32_t segment) {
+    char name[32];
+    snprintf(name, sizeof(name), "segment-%06u.bin", segment);
+    return dir + "/" + name;
+}
+void AuditSegments::startSegment(uint32_t n) {
+    segment = n;
+    memset(&entry, 0, sizeof(entry));
+    entry.segment = n;
+    if (out.is_open()) out.close();
+    out.open(auditSegmentPath(dir, n).c_str(), ios::binary | ios::app);
+}
+void AuditSegments::note(const AuditEvent& e) {
+    if (entry.count == 0 || e.when < entry.minTime) entry.minTime = e.when;
+    if (entry.count == 0 || e.when > entry.maxTime) entry.maxTime = e.when;
+    ++entry.count;
+    bloomAdd(entry.bloom, auditField(e.actor));
+    bloomAdd(entry.bloom, auditField(e.target));
+    dirty = true;
+}
+void AuditSegments::writeIndexEntry() {
+    string path = dir + "/index.dat";
+    fstream index(path.c_str(), ios::binary | ios::in | ios::out);
+    if (!index) index.open(path.c_str(), ios::binary | ios::out);
+    index.seekp((streamoff)(segment - 1) * (streamoff)sizeof(AuditIndexEntry));
+    index.write((const char*)&entry, sizeof(entry));
+    dirty = false;
+}
+void AuditSegments::open(const string& directory) {
+    dir = directory;
+    filesystem::create_directories(dir);
+    uint32_t last = 1;
+    while (filesystem::exists(auditSegmentPath(dir, last + 1))) ++last;
+    string data = readWholeFile(auditSegmentPath(dir, last).c_str());
+    size_t n = data.size() / sizeof(AuditEvent);
+    startSegment(last);
+    for (size_t i = 0; i < n; ++i) {
+        AuditEvent e;
+        memcpy(&e, data.data() + i * sizeof(AuditEvent), sizeof(e));
+        note(e);
+    }
+    if (data.size() % sizeof(AuditEvent)) {
+        // Torn event from a crash: rewrite the whole ones
+        out.close();
+        ofstream fix(auditSegmentPath(dir, last).c_str(), ios::binary | ios::trunc);
+        fix.write(data.data(), (streamsize)(n * sizeof(AuditEvent)));
+        fix.close();
+        out.open(auditSegmentPath(dir, last).c_str(), ios::binary | ios::app);
+    }
+    if (entry.count >= EVENTS_PER_SEGMENT) {
+        writeIndexEntry();
+        startSegment(last + 1);
+    }
+}
+void AuditSegments::append(const AuditEvent& e) {
+    out.write((const char*)&e, sizeof(e));
+    note(e);
+    if (entry.count >= EVENTS_PER_SEGMENT) {
+        out.flush();
+        writeIndexEntry();
+        startSegment(segment + 1);
+    }
+}
+void AuditSegments::flush() {
+    out.flush();
+    if (dirty) writeIndexEntry();
+}
+
+// --- Metrics: per-operation latency histograms ---
+thread_local uint64_t inputWaitNs = 0;
+int Metrics::bucketOf(uint64_t ns) {
+    if (ns < (1u << SUB_BITS)) return (int)ns;
+#ifdef __GNUC__
+    int e = 63 - __builtin_clzll(ns);
+#else
+    int e = 0;
+    while (ns >> (e + 1)) ++e;
+#endif
+    return ((e - SUB_BITS + 1) << SUB_BITS) + (int)((ns >> (e - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+}
+double Metrics::bucketValue(int b) {
+    if (b < (1 << SUB_BITS)) return b;
+    int e = (b >> SUB_BITS) + SUB_BITS - 1;
+    double low = (double)((uint64_t)((1 << SUB_BITS) + (b & ((1 << SUB_BITS) - 1))) << (e - SUB_BITS));
+    return low + (double)(1ull << (e - SUB_BITS)) / 2;
+}
+Metrics* Metrics::getInstance() {
+    if (!instance) {
+        instance = new Metrics();
+        atexit([] { instance->shutdown(); });
+    }
+    return instance;
+}
+Metrics::Block* Metrics::local() {
+    Block* b = localBlock;
+    return b ? b : attach();
+}
+void Metrics::record(MetricId id, uint64_t ns) {
+    if (!enabled.load(memory_order_relaxed)) return;
+    Block* b = local();
+    bump(b->calls[id], 1);
+    addSample(b, id, ns);
+}
+void Metrics::addSample(Block* b, MetricId id, uint64_t ns) {
+    bump(b->timed[id], 1);
+    bump(b->timedNs[id], ns);
+    if (ns > b->maxNs[id].load(memory_order_relaxed)) b->maxNs[id].store(ns, memory_order_relaxed);
+    int k = bucketOf(ns);
+    bump(b->buckets[id][k < BUCKETS ? k : BUCKETS - 1], 1);
+}
+void Metrics::start(const string& file, chrono::milliseconds every) {
+    lock_guard<mutex> lock(writerMutex);
+    path = file;
+    period = every;
+    if (!writer.joinable() && !stopping) writer = thread(&Metrics::run, this);
+}
+void Metrics::shutdown() {
+    {
+        lock_guard<mutex> lock(writerMutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    wake.notify_one();
+    if (writer.joinable()) writer.join();
+}
+string Metrics::render() {
+    vector<uint64_t> calls(M_COUNT), timed(M_COUNT), timedNs(M_COUNT), maxNs(M_COUNT);
+    vector<uint64_t> buckets((size_t)M_COUNT * BUCKETS);
+    {
+        lock_guard<mutex> lock(blocksMutex);
+        addBlock(retired, calls, timed, timedNs, maxNs, buckets);
+        for (size_t i = 0; i < blocks.size(); ++i) addBlock(*blocks[i], calls, timed, timedNs, maxNs, buckets);
+    }
+    ostringstream out;
+    out << setprecision(6);
+    const char* families[2][3] = {
+        {"sms_handler_seconds", "handler", "Time spent in a menu handler, not counting waits for input; quick calls are timed on a sample."},
+        {"sms_storage_seconds", "op", "Time spent in a storage primitive; quick calls are timed on a sample."}};
+    for (int f = 0; f < 2; ++f) {
+        const char* name = families[f][0];
+        const char* label = families[f][1];
+        out << "# HELP " << name << " " << families[f][2] << "\n# TYPE " << name << " summary\n";
+        int from = f ? M_FIRST_STORAGE : 0, to = f ? M_COUNT : M_FIRST_STORAGE;
+        for (int id = from; id < to; ++id) {
+            const uint64_t* hist = &buckets[(size_t)id * BUCKETS];
+            static const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+            for (double q : QUANTILES) {
+                out << name << "{" << label << "=\"" << METRIC_NAMES[id] << "\",quantile=\"" << q << "\"} ";
+                if (!timed[id]) {
+                    out << "NaN\n";
+                    continue;
+                }
+                uint64_t rank = (uint64_t)ceil(q * timed[id]), seen = 0;
+                int b = 0;
+                while (b < BUCKETS - 1 && (seen += hist[b]) < rank) ++b;
+                out << min(bucketValue(b), (double)maxNs[id]) / 1e9 << "\n";
+            }
+            // Sampled operations scale their time up to every call
+            double total = timed[id] ? (double)timedNs[id] * calls[id] / timed[id] : 0;
+            out << name << "_sum{" << label << "=\"" << METRIC_NAMES[id] << "\"} " << total / 1e9 << "\n";
+            out << name << "_count{" << label << "=\"" << METRIC_NAMES[id] << "\"} " << calls[id] << "\n";
+        }
+    }
+    out << "# HELP sms_max_seconds Slowest timed call of each operation.\n# TYPE sms_max_seconds gauge\n";
+    for (int id = 0; id < M_COUNT; ++id)
+        out << "sms_max_seconds{op=\"" << METRIC_NAMES[id] << "\"} " << maxNs[id] / 1e9 << "\n";
+    return out.str();
+}
+bool Metrics::writeFile(const string& file) {
+    string tmp = file + ".tmp";
+    {
+        ofstream out(tmp.c_str(), ios::trunc);
+        out << render();
+        if (!out.flush()) return false;
+    }
+    error_code ec;
+    filesystem::rename(tmp, file, ec);
+    return !ec;
+}
+Metrics::Detach::~Detach() {
+    if (localBlock) instance->release(localBlock);
+    localBlock = nullptr;
+}
+Metrics::Metrics() {
+    const int reads = 1000;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now(), last = start;
+    for (int i = 0; i < reads; ++i) last = chrono::steady_clock::now();
+    clockNs = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(last - start).count() / reads;
+    everyCallNs = max<uint64_t>(1, clockNs) * 2 * 200;
+}
+Metrics::Block* Metrics::attach() {
+    Metrics* m = getInstance();
+    Block* b = new Block();
+    for (int id = 0; id < M_COUNT; ++id) b->nextTimed[id] = 0;
+    {
+        lock_guard<mutex> lock(m->blocksMutex);
+        m->blocks.push_back(b);
+    }
+    localBlock = b;
+    thread_local Detach detach;
+    (void)detach;
+    return b;
+}
+void Metrics::release(Block* b) {
+    lock_guard<mutex> lock(blocksMutex);
+    for (int id = 0; id < M_COUNT; ++id) {
+        bump(retired.calls[id], b->calls[id].load(memory_order_relaxed));
+        bump(retired.timed[id], b->timed[id].load(memory_order_relaxed));
+        bump(retired.timedNs[id], b->timedNs[id].load(memory_order_relaxed));
+        uint64_t mx = b->maxNs[id].load(memory_order_relaxed);
+        if (mx > retired.maxNs[id].load(memory_order_relaxed)) retired.maxNs[id].store(mx, memory_order_relaxed);
+        for (int k = 0; k < BUCKETS; ++k) bump(retired.buckets[id][k], b->buckets[id][k].load(memory_order_relaxed));
+    }
+    blocks.erase(find(blocks.begin(), blocks.end(), b));
+    delete b;
+}
+void Metrics::addBlock(const Block& b, vector<uint64_t>& calls, vector<uint64_t>& timed, vector<uint64_t>& timedNs,
+                     vector<uint64_t>& maxNs, vector<uint64_t>& buckets) {
+    for (int id = 0; id < M_COUNT; ++id) {
+        calls[id] += b.calls[id].load(memory_order_relaxed);
+        timed[id] += b.timed[id].load(memory_order_relaxed);
+        timedNs[id] += b.timedNs[id].load(memory_order_relaxed);
+        maxNs[id] = max(maxNs[id], b.maxNs[id].load(memory_order_relaxed));
+        for (int k = 0; k < BUCKETS; ++k) buckets[(size_t)id * BUCKETS + k] += b.buckets[id][k].load(memory_order_relaxed);
+    }
+}
+void Metrics::run() {
+    unique_lock<mutex> lock(writerMutex);
+    while (true) {
+        bool stop = stopping || wake.wait_for(lock, period, [this] { return stopping; });
+        string file = path;
+        lock.unlock();
+        writeFile(file);
+        lock.lock();
+        if (stop) break;
+    }
+}
+Metrics* Metrics::instance = nullptr;
+thread_local Metrics::Block* Metrics::localBlock = nullptr;
+atomic<bool> Metrics::enabled{true};
+uint64_t Metrics::clockNs = 0;
+uint64_t Metrics::everyCallNs = 0;
+MetricTimer::MetricTimer(MetricId metric) : id(metric), block(nullptr) {
+    if (id == M_COUNT || !Metrics::enabled.load(memory_order_relaxed)) return;
+    Metrics::Block* b = Metrics::local();
+    call = b->calls[id].load(memory_order_relaxed);
+    b->calls[id].store(call + 1, memory_order_relaxed);
+    if (call < b->nextTimed[id]) return;
+    block = b;
+    waitAtStart = inputWaitNs;
+    start = chrono::steady_clock::now();
+}
+MetricTimer::~MetricTimer() {
+    if (!block) return;
+    uint64_t ns = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    uint64_t spent = inputWaitNs - waitAtStart + Metrics::clockNs;
+    ns = ns > spent ? ns - spent : 0;
+    Metrics::addSample(block, id, ns);
+    block->nextTimed[id] = call + 1 + min<uint64_t>(1023, Metrics::everyCallNs / max<uint64_t>(ns, 1));
+}
+Logger::Logger(const string& path, const string& auditDirectory)
+    : ring(new Slot[CAPACITY]), head(0), tail(0), unflushed(0), stopping(false), flushIntervalMs(200), flushBatch(256),
+      flushOnShutdown(true), auditDir(auditDirectory), stampSecond(-1) {
+    for (size_t i = 0; i < CAPACITY; ++i) ring[i].seq.store(i, memory_order_relaxed);
+    logFile.open(path.c_str(), ios::app);
+    writer = thread(&Logger::run, this);
+}
+size_t Logger::drain(string& batch) {
+    size_t n = 0;
+    while (true) {
+        Slot& s = ring[tail & (CAPACITY - 1)];
+        if (s.seq.load(memory_order_acquire) != tail + 1) break;
+        if (s.when != stampSecond) {
+            stampSecond = s.when;
+            stamp = ctime(&stampSecond);
+            if (!stamp.empty() && stamp.back() == '\n') stamp.pop_back();
+        }
+        batch += '[';
+        batch += stamp;
+        batch += "] ";
+        if (s.action == A_NOTE) {
+            batch.append(s.text, s.len);
+        } else {
+            string actor(s.text, s.actorLen), target(s.text + s.actorLen, s.len - s.actorLen);
+            batch += describeEvent(s.action, actor, target);
+            AuditEvent e;
+            memset(&e, 0, sizeof(e));
+            e.when = (int64_t)s.when;
+            e.action = (uint8_t)s.action;
+            setAuditField(e.actor, actor);
+            setAuditField(e.target, target);
+            audit.append(e);
+        }
+        batch += '\n';
+        s.seq.store(tail + CAPACITY, memory_order_release);
+        ++tail;
+        ++n;
+    }
+    return n;
+}
+void Logger::run() {
+    try {
+        audit.open(auditDir);
+    } catch (const exception&) {
+        // Text logging carries on without the audit log
+    }
+    string batch;
+    size_t pending = 0;
+    chrono::steady_clock::time_point lastFlush = chrono::steady_clock::now();
+    while (true) {
+        bool stop = stopping.load(memory_order_acquire);
+        chrono::milliseconds interval(flushIntervalMs.load(memory_order_relaxed));
+        size_t n = drain(batch);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool wrote = n > 0;
+        if (n) {
+            logFile.write(batch.data(), (streamsize)batch.size());
+            batch.clear();
+            pending += n;
+            unflushed.fetch_sub(n, memory_order_relaxed);
+        }
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (pending && (pending >= flushBatch.load(memory_order_relaxed) || now - lastFlush >= interval || stop)) {
+            if (!stop || flushOnShutdown.load(memory_order_relaxed)) {
+                logFile.flush();
+                audit.flush();
+                wrote = true;
+            }
+            pending = 0;
+            lastFlush = now;
+        }
+        if (wrote)
+            Metrics::record(M_LOG_WRITE, (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+        if (stop) break;
+        if (!n) {
+            unique_lock<mutex> lock(wakeMutex);
+            wake.wait_for(lock, interval);
+        }
+    }
+}
+Logger* Logger::getInstance() {
+    if (!instance) {
+        instance = new Logger();
+        atexit([] { instance->shutdown(); });
+    }
+    return instance;
+}
+void Logger::setFlushPolicy(const FlushPolicy& p) {
+    flushIntervalMs.store(p.interval.count(), memory_order_relaxed);
+    flushBatch.store(p.batchSize, memory_order_relaxed);
+    flushOnShutdown.store(p.flushOnShutdown, memory_order_relaxed);
+}
+void Logger::log(const string& text) {
+    Slot* s = claim();
+    if (!s) return;
+    s->action = A_NOTE;
+    s->len = min(text.size(), MAX_TEXT);
+    memcpy(s->text, text.data(), s->len);
+    publish(s);
+}
+void Logger::event(AuditAction action, string_view actor, string_view target) {
+    Slot* s = claim();
+    if (!s) return;
+    s->action = action;
+    s->actorLen = min(actor.size(), MAX_TEXT / 2);
+    s->len = s->actorLen + min(target.size(), MAX_TEXT - s->actorLen);
+    memcpy(s->text, actor.data(), s->actorLen);
+    memcpy(s->text + s->actorLen, target.data(), s->len - s->actorLen);
+    publish(s);
+}
+void Logger::shutdown() {
+    if (stopping.exchange(true)) return;
+    wake.notify_one();
+    if (writer.joinable()) writer.join();
+    logFile.close();
+}
+Logger::Slot* Logger::claim() {
+    if (stopping.load(memory_order_relaxed)) return nullptr;
+    size_t pos = head.load(memory_order_relaxed);
+    Slot* s;
+    while (true) {
+        s = &ring[pos & (CAPACITY - 1)];
+        size_t seq = s->seq.load(memory_order_acquire);
+        if (seq == pos) {
+            if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        } else if (seq < pos) {
+            // Ring is full: wait for the writer rather than lose a line,
+            // unless it is shutting down and will not drain it again
+            if (stopping.load(memory_order_acquire)) return nullptr;
+            this_thread::yield();
+            pos = head.load(memory_order_relaxed);
+        } else {
+            pos = head.load(memory_order_relaxed);
+        }
+    }
+    s->when = time(0);
+    return s;
+}
+void Logger::publish(Slot* s) {
+    size_t pos = s->seq.load(memory_order_relaxed);
+    s->seq.store(pos + 1, memory_order_release);
+    if (unflushed.fetch_add(1, memory_order_relaxed) + 1 == flushBatch.load(memory_order_relaxed)) wake.notify_one();
+}
+Logger* Logger::instance = nullptr;
+
+// --- Password hashing: SHA-256, HMAC and PBKDF2 ---
+void Sha256::compress(const uint8_t* p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+void Sha256::reset() {
+    static const uint32_t init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(h, init, sizeof(h));
+    used = 0;
+    total = 0;
+}
+void Sha256::update(const void* data, size_t n) {
+    const uint8_t* p = (const uint8_t*)data;
+    total += n;
+    if (used) {
+        size_t take = min(n, 64 - used);
+        memcpy(block + used, p, take);
+        used += take; p += take; n -= take;
+        if (used < 64) return;
+        compress(block);
+        used = 0;
+    }
+    for (; n >= 64; p += 64, n -= 64) compress(p);
+    memcpy(block, p, n);
+    used = n;
+}
+void Sha256::final(uint8_t out[32]) {
+    uint64_t bits = total * 8;
+    uint8_t pad = 0x80;
+    update(&pad, 1);
+    pad = 0;
+    while (used != 56) update(&pad, 1);
+    uint8_t len[8];
+    for (int i = 0; i < 8; ++i) len[i] = (uint8_t)(bits >> (56 - 8 * i));
+    update(len, 8);
+    for (int i = 0; i < 8; ++i) {
+        out[i * 4] = (uint8_t)(h[i] >> 24);
+        out[i * 4 + 1] = (uint8_t)(h[i] >> 16);
+        out[i * 4 + 2] = (uint8_t)(h[i] >> 8);
+        out[i * 4 + 3] = (uint8_t)h[i];
+    }
+}
+void pbkdf2Sha256(const string& password, const uint8_t* salt, size_t saltLen, uint32_t iterations, uint8_t out[32]) {
+    uint8_t key[64] = {0};
+    if (password.size() > 64) {
+        Sha256 kh;
+        kh.update(password.data(), password.size());
+        kh.final(key);
+    } else {
+        memcpy(key, password.data(), password.size());
+    }
+    uint8_t ipad[64], opad[64];
+    for (int i = 0; i < 64; ++i) {
+        ipad[i] = key[i] ^ 0x36;
+        opad[i] = key[i] ^ 0x5c;
+    }
+    Sha256 inner, outer;
+    inner.update(ipad, 64);
+    outer.update(opad, 64);
+    auto hmac = [&](const uint8_t* msg, size_t len, const uint8_t* msg2, size_t len2, uint8_t mac[32]) {
+        Sha256 ih = inner, oh = outer;
+        ih.update(msg, len);
+        if (len2) ih.update(msg2, len2);
+        ih.final(mac);
+        oh.update(mac, 32);
+        oh.final(mac);
+    };
+    const uint8_t blockIndex[4] = {0, 0, 0, 1};
+    uint8_t u[32];
+    hmac(salt, saltLen, blockIndex, 4, u);
+    memcpy(out, u, 32);
+    for (uint32_t r = 1; r < iterations; ++r) {
+        hmac(u, 32, nullptr, 0, u);
+        for (int i = 0; i < 32; ++i) out[i] ^= u[i];
+    }
+}
+string toHex(const uint8_t* p, size_t n) {
+    static const char digits[] = "0123456789abcdef";
+    string r(n * 2, '0');
+    for (size_t i = 0; i < n; ++i) {
+        r[i * 2] = digits[p[i] >> 4];
+        r[i * 2 + 1] = digits[p[i] & 15];
+    }
+    return r;
+}
+bool fromHex(const string& s, vector<uint8_t>& out) {
+    if (s.size() % 2) return false;
+    out.resize(s.size() / 2);
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (v < 0) return false;
+        out[i / 2] = (uint8_t)(i % 2 ? out[i / 2] | v : v << 4);
+    }
+    return true;
+}
+bool constantTimeEquals(const string& a, const string& b) {
+    unsigned char diff = a.size() != b.size();
+    size_t n = min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) diff |= (unsigned char)(a[i] ^ b[i]);
+    return diff == 0;
+}
+bool isHashedPassword(const string& stored) { return stored.compare(0, 4, PASSWORD_SCHEME) == 0; }
+string hashPassword(const string& password) {
+    random_device rd;
+    uint8_t salt[16];
+    for (int i = 0; i < 16; i += 4) {
+        uint32_t r = rd();
+        memcpy(salt + i, &r, 4);
+    }
+    uint8_t hash[32];
+    pbkdf2Sha256(password, salt, sizeof(salt), PASSWORD_ITERATIONS, hash);
+    return string(PASSWORD_SCHEME) + toHex(salt, sizeof(salt)) + "$" + toHex(hash, sizeof(hash));
+}
+bool checkPassword(const string& stored, const string& password) {
+    if (!isHashedPassword(stored)) return constantTimeEquals(stored, password);
+    size_t sep = stored.find('$', 4);
+    vector<uint8_t> salt;
+    if (sep == string::npos || !fromHex(stored.substr(4, sep - 4), salt)) return false;
+    uint8_t hash[32];
+    pbkdf2Sha256(password, salt.data(), salt.size(), PASSWORD_ITERATIONS, hash);
+    return constantTimeEquals(stored.substr(sep + 1), toHex(hash, sizeof(hash)));
+}
+
+// --- Record types ---
+uint32_t seatLimit(const CourseRecord& c) {
+    return (uint32_t)strtoul(c.capacity.c_str(), nullptr, 10);
+}
+int ageValue(const string& age) {
+    if (age.empty() || age.size() > 4 || age.find_first_not_of("0123456789") != string::npos) return -1;
+    return atoi(age.c_str());
+}
+int compareFolded(string_view a, string_view b) {
+    size_t n = min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char ca = (unsigned char)a[i], cb = (unsigned char)b[i];
+        if (ca >= 'A' && ca <= 'Z') ca += 32;
+        if (cb >= 'A' && cb <= 'Z') cb += 32;
+        if (ca != cb) return ca < cb ? -1 : 1;
+    }
+    return a.size() == b.size() ? 0 : a.size() < b.size() ? -1 : 1;
+}
+StudentView viewOf(const StudentRecord& s) { return {s.id, s.name, s.email, s.age, s.program, s.password}; }
+
+// --- Request arena: scratch memory for one menu request ---
+string_view RequestArena::copy(string_view s) {
+    if (s.empty()) return string_view();
+    char* p = (char*)pool.allocate(s.size(), 1);
+    memcpy(p, s.data(), s.size());
+    return string_view(p, s.size());
+}
+
+// --- Student table: one column per field, strings in an arena ---
+StudentTable::Ref StudentTable::store(string_view s) {
+    if (s.empty()) return {0, 0};
+    // Long strings get a block of their own
+    if (bases.empty() || s.size() > BLOCK_SIZE - used) {
+        if (bases.size() >= MAX_BLOCKS) throw runtime_error("Student table is full");
+        blocks.emplace_back(new char[max((size_t)BLOCK_SIZE, s.size())]);
+        bases.push_back(blocks.back().get());
+        used = 0;
+    }
+    Ref r = {(uint32_t)((bases.size() - 1) << BLOCK_BITS) | used, (uint32_t)s.size()};
+    memcpy(blocks.back().get() + used, s.data(), s.size());
+    used = s.size() >= BLOCK_SIZE ? BLOCK_SIZE : used + (uint32_t)s.size();
+    arenaBytes += s.size();
+    liveBytes += s.size();
+    return r;
+}
+string_view StudentTable::text(Ref r) const {
+    if (r.len == 0) return string_view();
+    return string_view(bases[r.at >> BLOCK_BITS] + (r.at & (BLOCK_SIZE - 1)), r.len);
+}
+uint32_t StudentTable::intern(string_view s, vector<string>& names, unordered_map<string, uint32_t>& ids) {
+    string key(s);
+    auto it = ids.find(key);
+    if (it != ids.end()) return it->second;
+    names.push_back(key);
+    ids.emplace(key, (uint32_t)(names.size() - 1));
+    return (uint32_t)(names.size() - 1);
+}
+uint32_t StudentTable::internProgram(string_view s) {
+    if (lastProgram < programNames.size() && programNames[lastProgram] == s) return lastProgram;
+    return lastProgram = intern(s, programNames, programIds);
+}
+int32_t StudentTable::encodeAge(string_view age) {
+    int v = ageValue(string(age));
+    if (v >= 0 && to_string(v) == age) return v;
+    return -1 - (int32_t)intern(age, oddAges, oddAgeIds);
+}
+void StudentTable::reserve(size_t n) {
+    ids.edit().reserve(n);
+    names.edit().reserve(n);
+    emails.edit().reserve(n);
+    passwords.edit().reserve(n);
+    programs.edit().reserve(n);
+    ages.edit().reserve(n);
+}
+bool StudentTable::adopt(shared_ptr<const MappedFile> from, const char* pool, uint64_t poolSize, const Ref* const columns[4],
+           const uint32_t* programColumn, const int32_t* ageColumn, size_t n, vector<string> programList,
+           vector<string> oddAgeList, uint64_t stringBytes) {
+    if (poolSize >= (uint64_t)MAX_BLOCKS << BLOCK_BITS) return false;
+    for (int c = 0; c < 4; ++c)
+        for (size_t i = 0; i < n; ++i)
+            if ((uint64_t)columns[c][i].at + columns[c][i].len > poolSize) return false;
+    for (size_t i = 0; i < n; ++i)
+        if (programColumn[i] >= programList.size() || (ageColumn[i] < 0 && (size_t)(-1 - (int64_t)ageColumn[i]) >= oddAgeList.size()))
+            return false;
+    clear();
+    file = move(from);
+    for (uint64_t at = 0; at < poolSize; at += BLOCK_SIZE) bases.push_back(pool + at);
+    // Later strings start an owned block
+    used = BLOCK_SIZE;
+    arenaBytes = liveBytes = stringBytes;
+    Column<Ref>* refs[4] = {&ids, &names, &emails, &passwords};
+    for (int c = 0; c < 4; ++c) refs[c]->adopt(columns[c], n);
+    programs.adopt(programColumn, n);
+    ages.adopt(ageColumn, n);
+    programNames = move(programList);
+    oddAges = move(oddAgeList);
+    for (uint32_t p = 0; p < programNames.size(); ++p) programIds.emplace(programNames[p], p);
+    for (uint32_t a = 0; a < oddAges.size(); ++a) oddAgeIds.emplace(oddAges[a], a);
+    return true;
+}
+void StudentTable::detach() {
+    Column<Ref>* refs[4] = {&ids, &names, &emails, &passwords};
+    for (int c = 0; c < 4; ++c) refs[c]->edit();
+    programs.edit();
+    ages.edit();
+    compactArena();
+    file.reset();
+}
+void StudentTable::append(string_view id, string_view name, string_view email, string_view age, string_view program, string_view password) {
+    ids.edit().push_back(store(id));
+    names.edit().push_back(store(name));
+    emails.edit().push_back(store(email));
+    passwords.edit().push_back(store(password));
+    programs.edit().push_back(internProgram(program));
+    ages.edit().push_back(encodeAge(age));
+}
+void StudentTable::assign(size_t i, const StudentView& s) {
+    release(i);
+    ids.edit()[i] = store(s.id);
+    names.edit()[i] = store(s.name);
+    emails.edit()[i] = store(s.email);
+    passwords.edit()[i] = store(s.password);
+    programs.edit()[i] = internProgram(s.program);
+    ages.edit()[i] = encodeAge(s.age);
+    if (arenaBytes > BLOCK_SIZE && garbageBytes() > liveBytes) compactArena();
+}
+void StudentTable::moveRow(size_t from, size_t to) {
+    if (from == to) return;
+    release(to);
+    Column<Ref>* refs[4] = {&ids, &names, &emails, &passwords};
+    for (int c = 0; c < 4; ++c) {
+        vector<Ref>& v = refs[c]->edit();
+        v[to] = v[from];
+        v[from] = Ref{0, 0};
+    }
+    programs.edit()[to] = programs[from];
+    ages.edit()[to] = ages[from];
+}
+void StudentTable::truncate(size_t n) {
+    for (size_t i = n; i < size(); ++i) release(i);
+    ids.edit().resize(n);
+    names.edit().resize(n);
+    emails.edit().resize(n);
+    passwords.edit().resize(n);
+    programs.edit().resize(n);
+    ages.edit().resize(n);
+}
+void StudentTable::compactArena() {
+    StudentTable fresh;
+    fresh.blocks.reserve(liveBytes / BLOCK_SIZE + 1);
+    vector<Ref>* columns[4] = {&ids.edit(), &names.edit(), &emails.edit(), &passwords.edit()};
+    for (int c = 0; c < 4; ++c)
+        for (size_t i = 0; i < columns[c]->size(); ++i) (*columns[c])[i] = fresh.store(text((*columns[c])[i]));
+    blocks.swap(fresh.blocks);
+    bases.swap(fresh.bases);
+    used = fresh.used;
+    arenaBytes = liveBytes = fresh.arenaBytes;
+}
+size_t StudentTable::memoryBytes() const {
+    size_t bytes = blocks.size() * BLOCK_SIZE + (ids.capacity() + names.capacity() + emails.capacity() + passwords.capacity()) * sizeof(Ref) +
+                   programs.capacity() * 4 + ages.capacity() * 4;
+    for (size_t p = 0; p < programNames.size(); ++p) bytes += programNames[p].capacity() + 64;
+    for (size_t a = 0; a < oddAges.size(); ++a) bytes += oddAges[a].capacity() + 64;
+    return bytes;
+}
+
+// --- Persistence: the only code that touches the data files ---
+uint32_t fnv1a(const char* data, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)data[i]) * 16777619u;
+    return h;
+}
+bool syncFd(int fd) {
+#ifdef _WIN32
+    return _commit(fd) == 0;
+#else
+    return fsync(fd) == 0;
+#endif
+}
+bool syncPath(const string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_BINARY);
+    if (fd < 0) return false;
+    bool ok = syncFd(fd);
+    close(fd);
+    return ok;
+}
+bool syncDirectory() {
+#ifdef _WIN32
+    return true;
+#else
+    int fd = open(".", O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+bool replaceFile(const string& from, const string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+void FileTransaction::writeSynced(const string& path, const string& data) {
+    {
+        ofstream fout(path.c_str(), ios::binary | ios::trunc);
+        fout.write(data.data(), (streamsize)data.size());
+        if (!fout.flush()) throw runtime_error("Cannot write " + path);
+    }
+    if (!syncPath(path)) throw runtime_error("Cannot sync " + path);
+}
+void FileTransaction::renameAll(const vector<string>& names) {
+    for (size_t i = 0; i < names.size(); ++i)
+        if (!replaceFile(staged(names[i]), names[i])) throw runtime_error("Cannot replace " + names[i]);
+    if (!syncDirectory()) throw runtime_error("Cannot sync the data directory");
+}
+void FileTransaction::commit() {
+    if (targets.empty()) return;
+    // One rename is atomic by itself and needs no manifest
+    bool manifest = targets.size() > 1;
+    if (manifest) {
+        string names;
+        for (size_t i = 0; i < targets.size(); ++i) names += targets[i] + "\n";
+        writeSynced(string(MANIFEST) + ".tmp", to_string(fnv1a(names.data(), names.size())) + "\n" + names);
+        if (!replaceFile(string(MANIFEST) + ".tmp", MANIFEST) || !syncDirectory())
+            throw runtime_error("Cannot commit " + string(MANIFEST));
+    }
+    renameAll(targets);
+    targets.clear();
+    if (manifest) {
+        remove(MANIFEST);
+        syncDirectory();
+    }
+}
+void FileTransaction::rollForward() {
+    string data = readWholeFile(MANIFEST);
+    if (data.empty()) return;
+    size_t nl = data.find('\n');
+    string names = nl == string::npos ? "" : data.substr(nl + 1);
+    // The manifest is renamed into place whole, so a bad one is not ours
+    if (nl != string::npos && data.substr(0, nl) == to_string(fnv1a(names.data(), names.size()))) {
+        vector<string> pending;
+        istringstream in(names);
+        string name;
+        while (getline(in, name))
+            if (filesystem::exists(staged(name))) pending.push_back(name);
+        renameAll(pending);
+    }
+    remove(MANIFEST);
+    syncDirectory();
+}
+const char* const FileTransaction::MANIFEST = "commit.manifest";
+uint64_t RecordFiles::loadStudents(StudentTable& out) {
+    return forEachRow("students.txt", 6, [&out](const string_view* f) { out.append(f[0], f[1], f[2], f[3], f[4], f[5]); });
+}
+CourseRecord RecordFiles::courseRow(const string_view* f) {
+    return {string(f[0]), string(f[1]), string(f[2]), f[3].empty() ? "0" : string(f[3])};
+}
+uint64_t RecordFiles::loadCourses(vector<CourseRecord>& out) {
+    return forEachRow("courses.txt", 4, [&out](const string_view* f) { out.push_back(courseRow(f)); });
+}
+void RecordFiles::writeStudent(ostream& out, const StudentView& s) {
+    out << s.id << "," << s.name << "," << s.email << "," << s.age << "," << s.program << "," << s.password << "\n";
+}
+void RecordFiles::writeCourse(ostream& out, const CourseRecord& c) {
+    out << c.code << "," << c.name << "," << c.units << "," << c.capacity << "\n";
+}
+void RecordFiles::writeEnrollment(ostream& out, const Enrollment& e) {
+    out << e.studentId << "," << e.courseCode << "\n";
+}
+string RecordFiles::renderStudents(const StudentTable& v, const vector<char>& live) {
+    ostringstream out;
+    for (size_t i = 0; i < v.size(); ++i)
+        if (live[i]) writeStudent(out, v.view(i));
+    return out.str();
+}
+string RecordFiles::renderCourses(const vector<CourseRecord>& v, const vector<char>& live) {
+    ostringstream out;
+    for (size_t i = 0; i < v.size(); ++i)
+        if (live[i]) writeCourse(out, v[i]);
+    return out.str();
+}
+void RecordFiles::loadCredentials(vector<pair<string, string> >& out) {
+    forEachRow("credentials.txt", 2, [&out](const string_view* f) { out.push_back({string(f[0]), string(f[1])}); });
+}
+void RecordFiles::saveCredentials(const vector<pair<string, string> >& v) {
+    FileTransaction tx;
+    tx.stage("credentials.txt", [&v](ostream& out) {
+        for (size_t i = 0; i < v.size(); ++i) out << v[i].first << "," << v[i].second << "\n";
+    });
+    tx.commit();
+}
+void RecordFiles::stageFile(FileTransaction& tx, const string& target, const string& data) {
+    tx.stage(target, [&data](ostream& out) { out.write(data.data(), (streamsize)data.size()); });
+}
+
+// --- Journal: append-only write-ahead log of mutations ---
+void Journal::setU32(string& out, size_t at, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[at + i] = (char)((v >> (8 * i)) & 0xff);
+}
+uint32_t Journal::getU32(const string& in, size_t at) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= (uint32_t)(unsigned char)in[at + i] << (8 * i);
+    return v;
+}
+void Journal::openForAppend(bool truncate) {
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_BINARY | (truncate ? O_TRUNC : 0);
+    fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) throw runtime_error("Cannot open journal " + path);
+}
+bool Journal::decode(const string& data, size_t& pos, JournalEntry& out) {
+    if (data.size() - pos < 8) return false;
+    uint32_t len = getU32(data, pos), sum = getU32(data, pos + 4);
+    if (len == 0 || data.size() - pos - 8 < len) return false;
+    const char* p = data.data() + pos + 8;
+    if (fnv1a(p, len) != sum) return false;
+    out.op = (unsigned char)p[0];
+    out.fields.clear();
+    size_t at = 1;
+    while (at < len) {
+        if (len - at < 2) return false;
+        size_t n = (unsigned char)p[at] | ((size_t)(unsigned char)p[at + 1] << 8);
+        if (len - at - 2 < n) return false;
+        out.fields.push_back(string(p + at + 2, n));
+        at += 2 + n;
+    }
+    pos += 8 + len;
+    return true;
+}
+Journal::Journal(const string& file)
+    : path(file), fd(-1), entries(0), bytes(0), stagedSeq(0), syncedSeq(0), durable(0), syncing(false), failures(0),
+      failedUpTo(0), torn(false), syncs(0) {}
+Journal::~Journal() {
+    if (fd >= 0) close(fd);
+}
+size_t Journal::syncCount() {
+    lock_guard<mutex> lock(m);
+    return syncs;
+}
+uint64_t Journal::stage(int op, initializer_list<string_view> fields) {
+    lock_guard<mutex> lock(m);
+    size_t at = pending.size();
+    pending.append(8, '\0');
+    pending += (char)op;
+    for (string_view f : fields) {
+        size_t n = min(f.size(), (size_t)0xffff);
+        pending += (char)(n & 0xff);
+        pending += (char)(n >> 8);
+        pending.append(f.data(), n);
+    }
+    size_t size = pending.size() - at - 8;
+    setU32(pending, at, (uint32_t)size);
+    setU32(pending, at + 4, fnv1a(pending.data() + at + 8, size));
+    ++entries;
+    bytes += 8 + size;
+    return ++stagedSeq;
+}
+void Journal::sync(uint64_t seq) {
+    unique_lock<mutex> lock(m);
+    uint64_t failuresSeen = failures;
+    while (syncedSeq < seq) {
+        if (torn) throw JournalError("Cannot write journal " + path + " until the next checkpoint");
+        if (failures != failuresSeen && seq <= failedUpTo) throw JournalError("Cannot write journal " + path);
+        if (syncing) {
+            synced.wait(lock);
+            continue;
+        }
+        // Lead: take the whole batch and write it without holding m
+        syncing = true;
+        string batch;
+        batch.swap(pending);
+        pending.swap(spare);
+        uint64_t upTo = stagedSeq, at = durable;
+        lock.unlock();
+        bool ok;
+        {
+            MetricTimer timer(M_JOURNAL_SYNC);
+            ok = write(fd, batch.data(), (unsigned)batch.size()) == (long)batch.size() && syncFd(fd);
+        }
+        // Part of a failed batch may have landed; cut it off, or replay
+        // would stop there and never reach the entries written after it
+#ifdef _WIN32
+        bool cut = ok || _chsize_s(fd, (__int64)at) == 0;
+#else
+        bool cut = ok || ftruncate(fd, (off_t)at) == 0;
+#endif
+        lock.lock();
+        syncing = false;
+        ++syncs;
+        if (ok) {
+            syncedSeq = upTo;
+            durable = at + batch.size();
+        } else {
+            // Back in front of whatever was staged meanwhile, for the next try
+            batch += pending;
+            pending.swap(batch);
+            ++failures;
+            failedUpTo = upTo;
+            torn = !cut;
+        }
+        // A bulk batch's buffer is not worth keeping
+        if (batch.capacity() <= (1 << 20)) {
+            batch.clear();
+            spare.swap(batch);
+        }
+        synced.notify_all();
+    }
+}
+void Journal::commit() {
+    uint64_t seq;
+    {
+        lock_guard<mutex> lock(m);
+        seq = stagedSeq;
+    }
+    sync(seq);
+}
+void Journal::reset() {
+    unique_lock<mutex> lock(m);
+    while (syncing) synced.wait(lock);
+    if (fd >= 0) close(fd);
+    fd = -1;
+    pending.clear();
+    syncedSeq = stagedSeq;
+    durable = 0;
+    torn = false;
+    entries = 0;
+    bytes = 0;
+    synced.notify_all();
+    remove(rotatedPath().c_str());
+    openForAppend(true);
+}
+bool Journal::rotate() {
+    unique_lock<mutex> lock(m);
+    while (syncing) synced.wait(lock);
+    if (filesystem::exists(rotatedPath())) return false;
+    if (fd >= 0) close(fd);
+    fd = -1;
+    if (!replaceFile(path, rotatedPath()) || !syncDirectory()) {
+        openForAppend(false);
+        return false;
+    }
+    openForAppend(true);
+    durable = 0;
+    torn = false;
+    entries = (size_t)(stagedSeq - syncedSeq);
+    bytes = pending.size();
+    return true;
+}
+void Journal::dropRotated() {
+    remove(rotatedPath().c_str());
+    syncDirectory();
+}
+
+// --- Snapshot: binary image of the Registry, loaded with mmap ---
+bool SourceStat::operator==(const SourceStat& o) const {
+    return device == o.device && inode == o.inode && size == o.size && mtimeNs == o.mtimeNs;
+}
+SourceStat statSource(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return SourceStat{0, 0, 0, -1};
+#if defined(__APPLE__)
+    int64_t ns = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    int64_t ns = (int64_t)st.st_mtime * 1000000000;
+#else
+    int64_t ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    return SourceStat{(uint64_t)st.st_dev, (uint64_t)st.st_ino, (uint64_t)st.st_size, ns};
+}
+SourceMark markSource(const char* path, uint64_t offset) {
+    SourceMark m;
+    m.file = statSource(path);
+    m.offset = offset;
+    uint64_t from = offset - min(offset, MARK_BYTES);
+    string tail = readFileRange(path, from, offset - from);
+    m.tailHash = fnv1a(tail.data(), tail.size());
+    m.lineEnd = tail.empty() || tail.back() == '\n';
+    return m;
+}
+SourceChange compareSource(const char* path, const SourceMark& m) {
+    SourceStat now = statSource(path);
+    // A missing file is mid-replacement; its successor will show up
+    if (now.mtimeNs < 0 || now == m.file) return SOURCE_SAME;
+    if (now.device != m.file.device || now.inode != m.file.inode) return SOURCE_REWRITTEN;
+    // Touched but no longer: an edit in place, which may be anywhere
+    if (now.size <= m.file.size || now.size < m.offset) return SOURCE_REWRITTEN;
+    uint64_t from = m.offset - min(m.offset, MARK_BYTES);
+    string tail = readFileRange(path, from, m.offset - from);
+    if (tail.size() != m.offset - from || fnv1a(tail.data(), tail.size()) != m.tailHash) return SOURCE_REWRITTEN;
+    // New rows after a last row that had no newline would be read mid-line
+    if (now.size > m.offset && !m.lineEnd) return SOURCE_REWRITTEN;
+    return SOURCE_APPENDED;
+}
+bool sourceMoved(const char* path, const SourceMark& m) {
+    SourceStat now = statSource(path);
+    return now.mtimeNs >= 0 && now != m.file;
+}
+MappedFile::MappedFile() : base(nullptr), length(0) {
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+    mapping = nullptr;
+#endif
+}
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (base) UnmapViewOfFile(base);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+    if (base) munmap((void*)base, length);
+#endif
+}
+bool MappedFile::open(const string& path) {
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) return false;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) return false;
+    base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    length = (size_t)size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+    base = (const char*)p;
+    length = (size_t)st.st_size;
+#endif
+    return base != nullptr;
+}
+uint64_t SnapWriter::section() {
+    while (out.size() % 8) out += '\0';
+    return out.size();
+}
+SnapString SnapWriter::str(string_view s) {
+    SnapString r = {(uint32_t)pool.size(), (uint32_t)s.size()};
+    pool += s;
+    return r;
+}
+
+// --- Process lock: one process at a time owns the data files ---
+#ifdef _WIN32
+bool ProcessLock::acquire(const string& path, bool shared, bool wait) {
+    while (_sopen_s(&fd, path.c_str(), _O_CREAT | _O_RDWR, shared ? _SH_DENYWR : _SH_DENYRW, _S_IREAD | _S_IWRITE) != 0) {
+        fd = -1;
+        if (!wait || errno != EACCES) return false;
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return true;
+}
+#else
+bool ProcessLock::acquire(const string& path, bool shared, bool wait) {
+    fd = ::open(path.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) return false;
+    int r;
+    do {
+        r = flock(fd, (shared ? LOCK_SH : LOCK_EX) | (wait ? 0 : LOCK_NB));
+    } while (r != 0 && errno == EINTR);
+    if (r == 0) return true;
+    ::close(fd);
+    fd = -1;
+    return false;
+}
+#endif
+
+// --- Edge lists: a sorted list of slots per row, for the enrollment index ---
+EdgeLists::Row EdgeLists::operator[](size_t i) const {
+    if (inMapping(i)) return Row{targets + offsets[i], offsets[i + 1] - offsets[i]};
+    return Row{rows[i].data(), rows[i].size()};
+}
+vector<uint32_t>& EdgeLists::edit(size_t i) {
+    if (inMapping(i)) {
+        rows[i].assign(targets + offsets[i], targets + offsets[i + 1]);
+        copied[i] = 1;
+    }
+    return rows[i];
+}
+vector<vector<uint32_t> >& EdgeLists::own() {
+    for (size_t i = 0; i < mappedRows; ++i)
+        if (!copied[i]) rows[i].assign(targets + offsets[i], targets + offsets[i + 1]);
+    mappedRows = 0;
+    vector<char>().swap(copied);
+    file.reset();
+    return rows;
+}
+bool EdgeLists::adopt(shared_ptr<const MappedFile> from, const uint32_t* csr, size_t n, size_t edges, size_t limit) {
+    const uint32_t* to = csr + n + 1;
+    if (csr[0] != 0 || csr[n] != edges) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (csr[i] > csr[i + 1]) return false;
+        for (uint32_t j = csr[i]; j < csr[i + 1]; ++j)
+            if (to[j] >= limit || (j > csr[i] && to[j] <= to[j - 1])) return false;
+    }
+    clear();
+    file = move(from);
+    offsets = csr;
+    targets = to;
+    mappedRows = n;
+    copied.assign(n, 0);
+    rows.resize(n);
+    return true;
+}
+
+// --- Registry Singleton: all records, loaded once at startup ---
+Registry::Registry(bool shareFiles)
+    : deadStudents(0), deadCourses(0), enrollmentCount(0), journal("journal.dat"), grouping(false), readOnly(false),
+      slotGeneration(0), slotLayout(0), secondaryDirty(true), groupIndexOps(0), textReady(false),
+      checkpointRunning(false) {
+    if (!dataLock.acquire("registry.lock")) {
+        if (!shareFiles)
+            throw runtime_error("Data files are in use by another process (use --connect to join a running server)");
+        readOnly = true;
+    }
+    bool indexed;
+    {
+        ProcessLock files;
+        lockFiles(files, readOnly);
+        // A checkpoint that crashed after its commit point is finished first
+        if (!readOnly) FileTransaction::rollForward();
+        snapshotCurrent = loadSnapshot("registry.snap");
+        if (!snapshotCurrent) loadText();
+        // Indexes from the snapshot are kept only if the journal changes nothing
+        indexed = !secondaryDirty;
+        secondaryDirty = true;
+        if (readOnly) journal.read([this](const JournalEntry& e) { applyEntry(e); });
+        else journal.replay([this](const JournalEntry& e) { applyEntry(e); });
+    }
+    resetSeats();
+    if (indexed && journal.entryCount() == 0) secondaryDirty = false;
+    else rebuildSecondary();
+}
+Registry::~Registry() {
+    unique_lock<shared_mutex> lock(rw);
+    checkpointDone.wait(lock, [this] { return !checkpointRunning; });
+    if (checkpointer.joinable()) checkpointer.join();
+}
+void Registry::lockFiles(ProcessLock& files, bool shared) {
+    if (!files.acquire("checkpoint.lock", shared, true)) throw runtime_error("Cannot lock checkpoint.lock");
+}
+void Registry::loadText() {
+    uint64_t studentBytes = RecordFiles::loadStudents(students);
+    uint64_t courseBytes = RecordFiles::loadCourses(courses);
+    studentLive.assign(students.size(), 1);
+    courseLive.assign(courses.size(), 1);
+    rebuildStudentIndex();
+    rebuildCourseIndex();
+
+    // Rows naming an unknown student or course, and repeated rows, are dropped
+    vector<vector<uint32_t> >& byStudent = studentCourses.own();
+    vector<vector<uint32_t> >& byCourse = courseStudents.own();
+    byStudent.resize(students.size());
+    byCourse.resize(courses.size());
+    uint64_t enrollmentBytes = RecordFiles::loadEnrollments([&](string_view sid, string_view code) {
+        long s = studentIds.find(sid, studentKey()), c = courseCodes.find(code, courseKey());
+        if (s < 0 || c < 0) return;
+        byStudent[s].push_back((uint32_t)c);
+        byCourse[c].push_back((uint32_t)s);
+    });
+    sources[0] = markSource(SNAP_SOURCES[0], studentBytes);
+    sources[1] = markSource(SNAP_SOURCES[1], courseBytes);
+    sources[2] = markSource(SNAP_SOURCES[2], enrollmentBytes);
+    for (size_t s = 0; s < byStudent.size(); ++s) sortUnique(byStudent[s]);
+    for (size_t c = 0; c < byCourse.size(); ++c) {
+        sortUnique(byCourse[c]);
+        enrollmentCount += byCourse[c].size();
+    }
+}
+bool Registry::loadSnapshot(const string& path) {
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    if (!file->open(path) || file->size() < sizeof(SnapHeader)) return false;
+    const char* base = file->data();
+    SnapHeader h;
+    memcpy(&h, base, sizeof(h));
+    if (memcmp(h.magic, SNAP_MAGIC, 8) != 0 || h.version != SNAP_VERSION || h.byteOrder != 0x01020304u)
+        return false;
+    if (h.fileSize != file->size() || h.poolAt + h.poolSize > h.fileSize) return false;
+    for (int i = 0; i < 3; ++i) {
+        SourceStat st = statSource(SNAP_SOURCES[i]);
+        if (st.size != h.sourceSize[i] || st.inode != h.sourceInode[i] || st.mtimeNs != h.sourceMtimeNs[i]) return false;
+    }
+    size_t ns = (size_t)h.studentCount, nc = (size_t)h.courseCount, ne = (size_t)h.enrollmentCount;
+    size_t np = (size_t)h.programCount, na = (size_t)h.oddAgeCount;
+    if (h.studentsAt + ns * 40 + (np + na) * sizeof(SnapString) > h.fileSize || h.coursesAt + nc * sizeof(SnapCourse) > h.fileSize ||
+        h.studentEdgesAt + (ns + 1 + ne) * 4 > h.fileSize || h.courseEdgesAt + (nc + 1 + ne) * 4 > h.fileSize ||
+        h.studentIndexAt + h.studentBuckets * 8 > h.fileSize || h.courseIndexAt + h.courseBuckets * 8 > h.fileSize)
+        return false;
+
+    const char* pool = base + h.poolAt;
+    auto text = [&](const SnapString& s) -> string_view {
+        if ((uint64_t)s.off + s.len > h.poolSize) throw runtime_error("Corrupt snapshot string");
+        return string_view(pool + s.off, s.len);
+    };
+    const SnapString* scols = (const SnapString*)(base + h.studentsAt);
+    const StudentTable::Ref* columns[4];
+    for (int c = 0; c < 4; ++c) columns[c] = (const StudentTable::Ref*)(scols + c * ns);
+    const uint32_t* programColumn = (const uint32_t*)(scols + 4 * ns);
+    const int32_t* ageColumn = (const int32_t*)(programColumn + ns);
+    const SnapString* names = (const SnapString*)(ageColumn + ns);
+    vector<string> programList, oddAgeList;
+    try {
+        for (size_t p = 0; p < np; ++p) programList.push_back(string(text(names[p])));
+        for (size_t a = 0; a < na; ++a) oddAgeList.push_back(string(text(names[np + a])));
+        const SnapCourse* crows = (const SnapCourse*)(base + h.coursesAt);
+        courses.resize(nc);
+        for (size_t i = 0; i < nc; ++i)
+            courses[i] = {string(text(crows[i].code)), string(text(crows[i].name)), string(text(crows[i].units)), string(text(crows[i].capacity))};
+    } catch (const exception&) {
+        courses.clear();
+        return false;
+    }
+    if (!students.adopt(file, pool, h.poolSize, columns, programColumn, ageColumn, ns, move(programList), move(oddAgeList),
+                        (size_t)h.studentStringBytes) ||
+        !studentCourses.adopt(file, (const uint32_t*)(base + h.studentEdgesAt), ns, ne, nc) ||
+        !courseStudents.adopt(file, (const uint32_t*)(base + h.courseEdgesAt), nc, ne, ns) ||
+        !studentIds.adopt((const FoldedKeyIndex::Bucket*)(base + h.studentIndexAt), (size_t)h.studentBuckets, (size_t)h.studentKeys, ns) ||
+        !courseCodes.adopt((const FoldedKeyIndex::Bucket*)(base + h.courseIndexAt), (size_t)h.courseBuckets, (size_t)h.courseKeys, nc)) {
+        students.clear();
+        courses.clear();
+        studentCourses.clear();
+        courseStudents.clear();
+        studentIds.clear();
+        courseCodes.clear();
+        return false;
+    }
+    studentLive.assign(ns, 1);
+    courseLive.assign(nc, 1);
+    enrollmentCount = ne;
+    for (int i = 0; i < 3; ++i) sources[i] = markSource(SNAP_SOURCES[i], h.sourceSize[i]);
+    if (h.secondaryAt) secondaryDirty = !loadSecondary(base, h, ns);
+#ifdef _WIN32
+    // A mapped file cannot be replaced there, and checkpoints replace it
+    students.detach();
+    studentCourses.own();
+    courseStudents.own();
+#endif
+    return true;
+}
+bool Registry::loadSecondary(const char* base, const SnapHeader& h, size_t ns) {
+    uint64_t at = h.secondaryAt;
+    auto take = [&](uint64_t words) -> const uint32_t* {
+        if (words > h.fileSize || at + words * 4 > h.fileSize) return nullptr;
+        const uint32_t* p = (const uint32_t*)(base + at);
+        at += words * 4;
+        return p;
+    };
+    size_t rows = MAX_INDEXED_AGE + 1, np = (size_t)h.programListCount;
+    const uint32_t* names = take(h.nameCount);
+    const uint32_t* ages = names ? take(rows + 1) : nullptr;
+    if (!ages || !take(ages[rows])) return false;
+    const SnapString* keys = (const SnapString*)take(np * 2);
+    const uint32_t* lists = keys ? take(np + 1) : nullptr;
+    if (!lists || !take(lists[np]) || h.nameCount > ns) return false;
+    for (size_t i = 0; i < h.nameCount; ++i)
+        if (names[i] >= ns) return false;
+    vector<vector<uint32_t> > programLists;
+    if (!readEdges(ages, rows, ages[rows], ns, byAge) || !readEdges(lists, np, lists[np], ns, programLists)) return false;
+    byName.assign(names, names + h.nameCount);
+    byProgram.clear();
+    for (size_t p = 0; p < np; ++p) {
+        if ((uint64_t)keys[p].off + keys[p].len > h.poolSize) return false;
+        byProgram[string(base + h.poolAt + keys[p].off, keys[p].len)].swap(programLists[p]);
+    }
+    return true;
+}
+bool Registry::readEdges(const uint32_t* csr, size_t n, size_t edges, size_t targets, vector<vector<uint32_t> >& lists) {
+    const uint32_t* rows = csr;
+    const uint32_t* to = csr + n + 1;
+    if (rows[0] != 0 || rows[n] != edges) return false;
+    lists.assign(n, vector<uint32_t>());
+    for (size_t i = 0; i < n; ++i) {
+        if (rows[i] > rows[i + 1] || rows[i + 1] > edges) return false;
+        lists[i].assign(to + rows[i], to + rows[i + 1]);
+        for (size_t j = 0; j < lists[i].size(); ++j)
+            if (lists[i][j] >= targets) return false;
+    }
+    return true;
+}
+string Registry::renderSnapshot() {
+    if (deadStudents) compactStudents();
+    if (deadCourses) compactCourses();
+    SnapWriter w;
+    SnapHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAP_MAGIC, 8);
+    h.version = SNAP_VERSION;
+    h.byteOrder = 0x01020304u;
+    h.studentCount = students.size();
+    h.courseCount = courses.size();
+    h.enrollmentCount = enrollmentCount;
+    w.put(h);
+
+    h.studentsAt = w.section();
+    typedef string_view (StudentTable::*Field)(size_t) const;
+    const Field fields[4] = {&StudentTable::id, &StudentTable::name, &StudentTable::email, &StudentTable::password};
+    for (int f = 0; f < 4; ++f)
+        for (size_t i = 0; i < students.size(); ++i) w.put(w.str((students.*fields[f])(i)));
+    for (size_t i = 0; i < students.size(); ++i) w.put(students.programId(i));
+    for (size_t i = 0; i < students.size(); ++i) w.put(students.ageCode(i));
+    for (uint32_t p = 0; p < students.programCount(); ++p) w.put(w.str(students.programName(p)));
+    for (size_t a = 0; a < students.oddAgeCount(); ++a) w.put(w.str(students.oddAge(a)));
+    h.programCount = students.programCount();
+    h.oddAgeCount = students.oddAgeCount();
+    h.studentStringBytes = students.stringBytes();
+    h.coursesAt = w.section();
+    for (size_t i = 0; i < courses.size(); ++i) {
+        SnapCourse r = {w.str(courses[i].code), w.str(courses[i].name), w.str(courses[i].units), w.str(courses[i].capacity)};
+        w.put(r);
+    }
+    h.studentEdgesAt = w.section();
+    writeEdges(w, studentCourses);
+    h.courseEdgesAt = w.section();
+    writeEdges(w, courseStudents);
+    h.studentIndexAt = w.section();
+    h.studentBuckets = studentIds.buckets().size();
+    h.studentKeys = studentIds.size();
+    w.out.append((const char*)studentIds.buckets().data(), studentIds.buckets().size() * 8);
+    h.courseIndexAt = w.section();
+    h.courseBuckets = courseCodes.buckets().size();
+    h.courseKeys = courseCodes.size();
+    w.out.append((const char*)courseCodes.buckets().data(), courseCodes.buckets().size() * 8);
+    if (!secondaryDirty) {
+        h.secondaryAt = w.section();
+        h.nameCount = byName.size();
+        w.out.append((const char*)byName.data(), byName.size() * 4);
+        writeEdges(w, byAge);
+        vector<EdgeLists::Row> lists;
+        for (auto it = byProgram.begin(); it != byProgram.end(); ++it) {
+            w.put(w.str(it->first));
+            lists.push_back({it->second.data(), it->second.size()});
+        }
+        h.programListCount = lists.size();
+        writeEdges(w, lists);
+    }
+    h.poolAt = w.section();
+    h.poolSize = w.pool.size();
+    w.out += w.pool;
+    h.fileSize = w.out.size();
+    memcpy(&w.out[0], &h, sizeof(h));
+    return move(w.out);
+}
+void Registry::stampSnapshot(string& image) {
+    SnapHeader h;
+    memcpy(&h, image.data(), sizeof(h));
+    for (int i = 0; i < 3; ++i) {
+        SourceStat st = statSource(SNAP_SOURCES[i]);
+        h.sourceSize[i] = st.size;
+        h.sourceInode[i] = st.inode;
+        h.sourceMtimeNs[i] = st.mtimeNs;
+    }
+    memcpy(&image[0], &h, sizeof(h));
+}
+void Registry::sortUnique(vector<uint32_t>& v) {
+    sort(v.begin(), v.end());
+    v.erase(unique(v.begin(), v.end()), v.end());
+}
+bool Registry::insertSorted(vector<uint32_t>& v, uint32_t x) {
+    vector<uint32_t>::iterator it = lower_bound(v.begin(), v.end(), x);
+    if (it != v.end() && *it == x) return false;
+    v.insert(it, x);
+    return true;
+}
+bool Registry::eraseSorted(vector<uint32_t>& v, uint32_t x) {
+    vector<uint32_t>::iterator it = lower_bound(v.begin(), v.end(), x);
+    if (it == v.end() || *it != x) return false;
+    v.erase(it);
+    return true;
+}
+void Registry::remap(vector<vector<uint32_t> >& lists, const vector<uint32_t>& newSlot) {
+    for (size_t i = 0; i < lists.size(); ++i)
+        for (size_t j = 0; j < lists[i].size(); ++j) lists[i][j] = newSlot[lists[i][j]];
+}
+string Registry::renderEnrollments() const {
+    ostringstream out;
+    for (size_t s = 0; s < students.size(); ++s) {
+        EdgeLists::Row list = studentCourses[s];
+        for (size_t j = 0; j < list.size(); ++j)
+            RecordFiles::writeEnrollment(out, {string(students.id(s)), courses[list[j]].code});
+    }
+    return out.str();
+}
+void Registry::rebuildStudentIndex() {
+    studentIds.clear();
+    studentIds.reserve(students.size());
+    for (size_t i = 0; i < students.size(); ++i) {
+        // On duplicate IDs in the file the first row wins, as the old scans did
+        if (studentLive[i] && studentIds.find(students.id(i), studentKey()) < 0)
+            studentIds.insert(students.id(i), (uint32_t)i);
+    }
+}
+void Registry::rebuildCourseIndex() {
+    courseCodes.clear();
+    courseCodes.reserve(courses.size());
+    for (size_t i = 0; i < courses.size(); ++i) {
+        if (courseLive[i] && courseCodes.find(courses[i].code, courseKey()) < 0)
+            courseCodes.insert(courses[i].code, (uint32_t)i);
+    }
+}
+void Registry::compactStudents() {
+    vector<vector<uint32_t> >& byStudent = studentCourses.own();
+    vector<uint32_t> newSlot(students.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < students.size(); ++i) {
+        if (!studentLive[i]) continue;
+        newSlot[i] = (uint32_t)kept;
+        students.moveRow(i, kept);
+        swap(byStudent[kept], byStudent[i]);
+        ++kept;
+    }
+    students.truncate(kept);
+    students.compactArena();
+    ++slotLayout;
+    byStudent.resize(kept);
+    remap(courseStudents.own(), newSlot);
+    studentLive.assign(kept, 1);
+    deadStudents = 0;
+    rebuildStudentIndex();
+    dropText();
+    // Slots moved: rebuild now, or once the bulk change ends
+    if (grouping) secondaryDirty = true;
+    else if (!secondaryDirty) rebuildSecondary();
+}
+bool Registry::programLess(uint32_t a, uint32_t b) const {
+    int aa = students.age(a), ab = students.age(b);
+    return aa != ab ? aa < ab : a < b;
+}
+bool Registry::nameLess(uint32_t a, uint32_t b) const {
+    int c = compareFolded(students.name(a), students.name(b));
+    return c != 0 ? c < 0 : a < b;
+}
+int Registry::ageBucket(uint32_t slot) const {
+    int age = students.age(slot);
+    return age < 0 ? -1 : min(age, MAX_INDEXED_AGE);
+}
+void Registry::rebuildSecondary() {
+    byProgram.clear();
+    byAge.assign(MAX_INDEXED_AGE + 1, vector<uint32_t>());
+    byName.clear();
+    byName.reserve(students.size() - deadStudents);
+    // Spellings differing in case share a list
+    programKeys.clear();
+    vector<vector<uint32_t>*> lists(students.programCount());
+    for (uint32_t p = 0; p < lists.size(); ++p) lists[p] = &byProgram[programKey(p)];
+    for (size_t i = 0; i < students.size(); ++i) {
+        if (!studentLive[i]) continue;
+        lists[students.programId(i)]->push_back((uint32_t)i);
+        int b = ageBucket((uint32_t)i);
+        if (b >= 0) byAge[b].push_back((uint32_t)i);
+        byName.push_back((uint32_t)i);
+    }
+    // Lists were filled in slot order, so a stable sort on age keeps the slot tie-break
+    for (auto it = byProgram.begin(); it != byProgram.end();) {
+        if (it->second.empty()) {
+            it = byProgram.erase(it);
+            continue;
+        }
+        stable_sort(it->second.begin(), it->second.end(), [this](uint32_t a, uint32_t b) { return students.age(a) < students.age(b); });
+        ++it;
+    }
+    // Sort on folded copies; folding inside the comparator would redo it on every compare
+    vector<string> folded(students.size());
+    for (size_t j = 0; j < byName.size(); ++j) folded[byName[j]] = foldCase(students.name(byName[j]));
+    sort(byName.begin(), byName.end(), [&folded](uint32_t a, uint32_t b) {
+        return folded[a] != folded[b] ? folded[a] < folded[b] : a < b;
+    });
+    secondaryDirty = false;
+}
+const string& Registry::programKey(uint32_t program) {
+    while (programKeys.size() <= program) programKeys.push_back(foldCase(trim(students.programName((uint32_t)programKeys.size()))));
+    return programKeys[program];
+}
+bool Registry::secondaryLive() {
+    if (grouping && ++groupIndexOps > BULK_INDEX_OPS) secondaryDirty = true;
+    return !secondaryDirty;
+}
+void Registry::indexStudent(uint32_t slot) {
+    if (textLive()) studentText.insert(slot, searchText(students.view(slot)));
+    if (!secondaryLive()) return;
+    vector<uint32_t>& list = byProgram[programKey(students.programId(slot))];
+    list.insert(upper_bound(list.begin(), list.end(), slot, [this](uint32_t a, uint32_t b) { return programLess(a, b); }), slot);
+    int b = ageBucket(slot);
+    if (b >= 0) insertSorted(byAge[b], slot);
+    byName.insert(upper_bound(byName.begin(), byName.end(), slot, [this](uint32_t x, uint32_t y) { return nameLess(x, y); }), slot);
+}
+void Registry::unindexStudent(uint32_t slot) {
+    if (textLive()) studentText.erase(slot);
+    if (!secondaryLive()) return;
+    auto it = byProgram.find(programKey(students.programId(slot)));
+    if (it != byProgram.end()) {
+        vector<uint32_t>& list = it->second;
+        auto at = lower_bound(list.begin(), list.end(), slot, [this](uint32_t a, uint32_t b) { return programLess(a, b); });
+        if (at != list.end() && *at == slot) list.erase(at);
+        if (list.empty()) byProgram.erase(it);
+    }
+    int b = ageBucket(slot);
+    if (b >= 0) eraseSorted(byAge[b], slot);
+    auto at = lower_bound(byName.begin(), byName.end(), slot, [this](uint32_t x, uint32_t y) { return nameLess(x, y); });
+    if (at != byName.end() && *at == slot) byName.erase(at);
+}
+string Registry::searchText(const StudentView& s) {
+    string text(s.id);
+    text.append(" ").append(s.name).append(" ").append(s.email.substr(0, s.email.find('@')));
+    return text;
+}
+void Registry::buildText() const {
+    if (textReady.load(memory_order_acquire)) return;
+    lock_guard<mutex> guard(textBuild);
+    if (textReady.load(memory_order_relaxed)) return;
+    studentText.build(students.size(), [this](size_t i, string& text) {
+        if (studentLive[i]) text = searchText(students.view(i));
+        return studentLive[i] != 0;
+    });
+    courseText.build(courses.size(), [this](size_t i, string& text) {
+        if (courseLive[i]) text = searchText(courses[i]);
+        return courseLive[i] != 0;
+    });
+    textReady.store(true, memory_order_release);
+}
+void Registry::dropText() {
+    studentText.clear();
+    courseText.clear();
+    textReady.store(false, memory_order_relaxed);
+}
+bool Registry::textLive() {
+    if (!textReady.load(memory_order_relaxed)) return false;
+    if (grouping && groupIndexOps > BULK_INDEX_OPS) {
+        dropText();
+        return false;
+    }
+    return true;
+}
+size_t Registry::resumeSlot(const vector<char>& live, size_t slot, uint64_t layout, size_t skip) const {
+    if (layout == slotLayout) return min(slot, live.size());
+    size_t i = 0;
+    for (; i < live.size() && skip; ++i)
+        if (live[i]) --skip;
+    return i;
+}
+void Registry::resetSeats() {
+    pendingSeats.clear();
+    for (size_t i = 0; i < courses.size(); ++i) pendingSeats.emplace_back(0);
+    ++slotGeneration;
+    ++slotLayout;
+}
+bool Registry::reserveSeat(long c) const {
+    uint32_t limit = seatLimit(courses[c]);
+    size_t taken = courseStudents[c].size();
+    atomic<uint32_t>& pending = pendingSeats[c];
+    uint32_t p = pending.load(memory_order_relaxed);
+    do {
+        if (limit && taken + p >= limit) return false;
+    } while (!pending.compare_exchange_weak(p, p + 1, memory_order_relaxed));
+    return true;
+}
+void Registry::compactCourses() {
+    vector<vector<uint32_t> >& byCourse = courseStudents.own();
+    vector<uint32_t> newSlot(courses.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < courses.size(); ++i) {
+        if (!courseLive[i]) continue;
+        newSlot[i] = (uint32_t)kept;
+        swap(courses[kept], courses[i]);
+        swap(byCourse[kept], byCourse[i]);
+        ++kept;
+    }
+    courses.resize(kept);
+    byCourse.resize(kept);
+    remap(studentCourses.own(), newSlot);
+    courseLive.assign(kept, 1);
+    deadCourses = 0;
+    rebuildCourseIndex();
+    dropText();
+    resetSeats();
+}
+StudentView Registry::copyStudent(size_t i, RequestArena& a) const {
+    return {a.copy(students.id(i)), a.copy(students.name(i)), a.copy(students.email(i)), students.ageText(i),
+            a.copy(students.program(i)), a.copy(students.password(i))};
+}
+long Registry::studentIndex(string_view id) const {
+    MetricTimer timer(M_INDEX_LOOKUP);
+    return studentIds.find(trimView(id), studentKey());
+}
+long Registry::courseIndex(string_view code) const {
+    MetricTimer timer(M_INDEX_LOOKUP);
+    return courseCodes.find(trimView(code), courseKey());
+}
+Registry* Registry::getInstance() {
+    if (!instance)
+        instance = new Registry();
+    return instance;
+}
+Registry* Registry::getReadOnlyInstance() {
+    if (!instance)
+        instance = new Registry(true);
+    return instance;
+}
+bool Registry::hasStudent(string_view id) const {
+    shared_lock<shared_mutex> lock(rw);
+    return studentIndex(id) >= 0;
+}
+bool Registry::hasCourse(string_view code) const {
+    shared_lock<shared_mutex> lock(rw);
+    return courseIndex(code) >= 0;
+}
+bool Registry::findStudent(string_view id, StudentRecord& out) const {
+    shared_lock<shared_mutex> lock(rw);
+    long i = studentIndex(id);
+    if (i < 0) return false;
+    out = students.record(i);
+    return true;
+}
+bool Registry::findStudent(string_view id, StudentView& out, RequestArena& arena) const {
+    shared_lock<shared_mutex> lock(rw);
+    long i = studentIndex(id);
+    if (i < 0) return false;
+    out = copyStudent(i, arena);
+    return true;
+}
+bool Registry::findCourse(string_view code, CourseRecord& out) const {
+    shared_lock<shared_mutex> lock(rw);
+    long i = courseIndex(code);
+    if (i < 0) return false;
+    out = courses[i];
+    return true;
+}
+bool Registry::isEnrolled(string_view sid, string_view code) const {
+    shared_lock<shared_mutex> lock(rw);
+    long s = studentIndex(sid), c = courseIndex(code);
+    if (s < 0 || c < 0) return false;
+    // Search whichever side has the shorter list
+    if (studentCourses[s].size() <= courseStudents[c].size())
+        return binary_search(studentCourses[s].begin(), studentCourses[s].end(), (uint32_t)c);
+    return binary_search(courseStudents[c].begin(), courseStudents[c].end(), (uint32_t)s);
+}
+vector<CourseRecord> Registry::coursesOf(string_view sid) const {
+    vector<CourseRecord> out;
+    shared_lock<shared_mutex> lock(rw);
+    long s = studentIndex(sid);
+    if (s < 0) return out;
+    EdgeLists::Row list = studentCourses[s];
+    out.reserve(list.size());
+    for (size_t i = 0; i < list.size(); ++i) out.push_back(courses[list[i]]);
+    return out;
+}
+pmr::vector<CourseView> Registry::coursesOf(string_view sid, RequestArena& arena) const {
+    pmr::vector<CourseView> out(arena.resource());
+    shared_lock<shared_mutex> lock(rw);
+    long s = studentIndex(sid);
+    if (s < 0) return out;
+    EdgeLists::Row list = studentCourses[s];
+    out.reserve(list.size());
+    for (size_t i = 0; i < list.size(); ++i) {
+        const CourseRecord& c = courses[list[i]];
+        out.push_back({arena.copy(c.code), arena.copy(c.name), arena.copy(c.units), arena.copy(c.capacity)});
+    }
+    return out;
+}
+size_t Registry::rosterSize(string_view code) const {
+    shared_lock<shared_mutex> lock(rw);
+    long c = courseIndex(code);
+    return c < 0 ? 0 : courseStudents[c].size();
+}
+vector<StudentRecord> Registry::studentsIn(string_view code) const {
+    vector<StudentRecord> out;
+    shared_lock<shared_mutex> lock(rw);
+    long c = courseIndex(code);
+    if (c < 0) return out;
+    EdgeLists::Row list = courseStudents[c];
+    out.reserve(list.size());
+    for (size_t i = 0; i < list.size(); ++i) out.push_back(students.record(list[i]));
+    return out;
+}
+size_t Registry::enrollmentTotal() const {
+    shared_lock<shared_mutex> lock(rw);
+    return enrollmentCount;
+}
+vector<StudentRecord> Registry::searchStudents(string_view query, size_t k) const {
+    MetricTimer timer(M_TEXT_SEARCH);
+    shared_lock<shared_mutex> lock(rw);
+    buildText();
+    vector<TextIndex::Hit> hits = studentText.search(query, k);
+    vector<StudentRecord> found;
+    for (size_t i = 0; i < hits.size(); ++i) found.push_back(students.record(hits[i].slot));
+    return found;
+}
+vector<CourseRecord> Registry::searchCourses(string_view query, size_t k) const {
+    MetricTimer timer(M_TEXT_SEARCH);
+    shared_lock<shared_mutex> lock(rw);
+    buildText();
+    vector<TextIndex::Hit> hits = courseText.search(query, k);
+    vector<CourseRecord> found;
+    for (size_t i = 0; i < hits.size(); ++i) found.push_back(courses[hits[i].slot]);
+    return found;
+}
+void Registry::addStudent(const StudentRecord& s) {
+    unique_lock<shared_mutex> lock(rw);
+    applyAddStudent(s);
+    uint64_t seq = record(J_ADD_STUDENT, {s.id, s.name, s.email, s.age, s.program, s.password});
+    lock.unlock();
+    journal.sync(seq);
+}
+void Registry::addCourse(const CourseRecord& c) {
+    unique_lock<shared_mutex> lock(rw);
+    applyAddCourse(c);
+    uint64_t seq = record(J_ADD_COURSE, {c.code, c.name, c.units, c.capacity});
+    lock.unlock();
+    journal.sync(seq);
+}
+bool Registry::updateStudent(const StudentView& s) {
+    unique_lock<shared_mutex> lock(rw);
+    if (!applyUpdateStudent(s)) return false;
+    uint64_t seq = record(J_UPDATE_STUDENT, {s.id, s.name, s.email, s.age, s.program, s.password});
+    lock.unlock();
+    journal.sync(seq);
+    return true;
+}
+UpdateResult Registry::updateCourse(const CourseRecord& c) {
+    unique_lock<shared_mutex> lock(rw);
+    long i = courseIndex(c.code);
+    if (i < 0) return UPDATE_NOT_FOUND;
+    if (seatLimit(c) && courseStudents[i].size() > seatLimit(c)) return UPDATE_BELOW_ROSTER;
+    applyUpdateCourse(c);
+    uint64_t seq = record(J_UPDATE_COURSE, {c.code, c.name, c.units, c.capacity});
+    lock.unlock();
+    journal.sync(seq);
+    return UPDATE_OK;
+}
+bool Registry::removeStudent(const string& id) {
+    unique_lock<shared_mutex> lock(rw);
+    if (!applyRemoveStudent(id)) return false;
+    uint64_t seq = record(J_REMOVE_STUDENT, {trimView(id)});
+    lock.unlock();
+    journal.sync(seq);
+    return true;
+}
+bool Registry::removeCourse(const string& code) {
+    unique_lock<shared_mutex> lock(rw);
+    if (!applyRemoveCourse(code)) return false;
+    uint64_t seq = record(J_REMOVE_COURSE, {trimView(code)});
+    lock.unlock();
+    journal.sync(seq);
+    return true;
+}
+EnrollResult Registry::enroll(string_view sid, string_view code) {
+    while (true) {
+        long c;
+        uint64_t generation;
+        {
+            shared_lock<shared_mutex> lock(rw);
+            long s = studentIndex(sid);
+            c = courseIndex(code);
+            if (s < 0 || c < 0) return ENROLL_NOT_FOUND;
+            if (binary_search(studentCourses[s].begin(), studentCourses[s].end(), (uint32_t)c)) return ENROLL_ALREADY;
+            if (!reserveSeat(c)) return ENROLL_FULL;
+            generation = slotGeneration;
+        }
+        unique_lock<shared_mutex> lock(rw);
+        // A compaction in between dropped the reservation; start over
+        if (generation != slotGeneration) continue;
+        pendingSeats[c].fetch_sub(1, memory_order_relaxed);
+        // The course was deleted (and maybe re-added) in between
+        if (courseIndex(code) != c) continue;
+        // Or its cap was lowered: the roster under this lock is the truth
+        if (seatLimit(courses[c]) && courseStudents[c].size() >= seatLimit(courses[c])) return ENROLL_FULL;
+        if (!applyEnroll(sid, code)) return studentIndex(sid) < 0 ? ENROLL_NOT_FOUND : ENROLL_ALREADY;
+        uint64_t seq = record(J_ENROLL, {trimView(sid), trimView(code)});
+        lock.unlock();
+        journal.sync(seq);
+        return ENROLL_OK;
+    }
+}
+bool Registry::drop(string_view sid, string_view code) {
+    unique_lock<shared_mutex> lock(rw);
+    if (!applyDrop(sid, code)) return false;
+    uint64_t seq = record(J_DROP, {trimView(sid), trimView(code)});
+    lock.unlock();
+    journal.sync(seq);
+    return true;
+}
+void Registry::beginGroup() {
+    unique_lock<shared_mutex> lock(rw);
+    grouping = true;
+    groupIndexOps = 0;
+}
+void Registry::commitGroup() {
+    unique_lock<shared_mutex> lock(rw);
+    grouping = false;
+    if (secondaryDirty) rebuildSecondary();
+    journal.commit();
+}
+void Registry::checkpoint() {
+    unique_lock<shared_mutex> lock(rw);
+    // One started by a mutation finishes first
+    checkpointDone.wait(lock, [this] { return !checkpointRunning; });
+    checkpointLocked();
+}
+SourceRefresh Registry::refreshSources() {
+    {
+        shared_lock<shared_mutex> lock(rw);
+        // The checkpointer is replacing the files; look again once it is done
+        if (checkpointRunning) return {0, false};
+        bool moved = false;
+        for (int i = 0; i < 3 && !moved; ++i) moved = sourceMoved(SNAP_SOURCES[i], sources[i]);
+        if (!moved) return {0, false};
+    }
+    unique_lock<shared_mutex> lock(rw);
+    if (checkpointRunning) return {0, false};
+    MetricTimer timer(M_REFRESH);
+    return absorbSources();
+}
+SourceRefresh Registry::absorbSources() {
+    SourceChange change[3];
+    for (int i = 0; i < 3; ++i) change[i] = compareSource(SNAP_SOURCES[i], sources[i]);
+    for (int i = 0; i < 3; ++i)
+        if (change[i] == SOURCE_REWRITTEN) {
+            reloadLocked();
+            return {0, true};
+        }
+    // Students and courses first, for enrollments appended alongside them
+    size_t rows = 0;
+    for (int i = 0; i < 3; ++i)
+        if (change[i] == SOURCE_APPENDED) rows += tailSource(i);
+    return {rows, false};
+}
+size_t Registry::tailSource(int i) {
+    const char* path = SNAP_SOURCES[i];
+    uint64_t size = statSource(path).size;
+    string data = size > sources[i].offset ? readFileRange(path, sources[i].offset, size - sources[i].offset) : string();
+    size_t used = data.rfind('\n') == string::npos ? 0 : data.rfind('\n') + 1;
+    size_t rows = 0;
+    string_view text(data.data(), used);
+    if (i == 0) {
+        forEachCsvLine(text, 6, [&](const string_view* f) {
+            if (studentIndex(f[0]) < 0)
+                applyAddStudent({string(f[0]), string(f[1]), string(f[2]), string(f[3]), string(f[4]), string(f[5])});
+            ++rows;
+        });
+    } else if (i == 1) {
+        forEachCsvLine(text, 4, [&](const string_view* f) {
+            if (courseIndex(f[0]) < 0) applyAddCourse(RecordFiles::courseRow(f));
+            ++rows;
+        });
+    } else {
+        forEachCsvLine(text, 2, [&](const string_view* f) {
+            applyEnroll(f[0], f[1]);
+            ++rows;
+        });
+    }
+    sources[i] = markSource(path, sources[i].offset + used);
+    if (used) snapshotCurrent = false;
+    return rows;
+}
+void Registry::reloadLocked() {
+    students.clear();
+    studentLive.clear();
+    deadStudents = 0;
+    courses.clear();
+    courseLive.clear();
+    deadCourses = 0;
+    studentCourses.clear();
+    courseStudents.clear();
+    enrollmentCount = 0;
+    studentIds.clear();
+    courseCodes.clear();
+    dropText();
+    secondaryDirty = true;
+    loadText();
+    journal.reread([this](const JournalEntry& e) { applyEntry(e); });
+    resetSeats();
+    rebuildSecondary();
+    snapshotCurrent = false;
+}
+Registry::CheckpointImage Registry::renderCheckpoint() {
+    CheckpointImage image;
+    image.text = journal.entryCount() > 0;
+    image.snapshot = renderSnapshot();
+    if (image.text) {
+        image.students = RecordFiles::renderStudents(students, studentLive);
+        image.courses = RecordFiles::renderCourses(courses, courseLive);
+        image.enrollments = renderEnrollments();
+    }
+    return image;
+}
+void Registry::writeCheckpoint(CheckpointImage& image) {
+    if (image.text) {
+        FileTransaction tx;
+        RecordFiles::stageFile(tx, "students.txt", image.students);
+        RecordFiles::stageFile(tx, "courses.txt", image.courses);
+        RecordFiles::stageFile(tx, "enrollments.txt", image.enrollments);
+        tx.commit();
+        for (int i = 0; i < 3; ++i) image.marks[i] = markSource(SNAP_SOURCES[i], statSource(SNAP_SOURCES[i]).size);
+    }
+    stampSnapshot(image.snapshot);
+    FileTransaction tx;
+    RecordFiles::stageFile(tx, "registry.snap", image.snapshot);
+    tx.commit();
+}
+void Registry::installCheckpoint(const CheckpointImage& image) {
+    if (image.text)
+        for (int i = 0; i < 3; ++i) sources[i] = image.marks[i];
+    snapshotCurrent = true;
+}
+void Registry::checkpointLocked() {
+    if (readOnly) return;
+    // Rows other programs appended would be lost to the rewrite
+    absorbSources();
+    if (journal.entryCount() == 0 && snapshotCurrent) return;
+    MetricTimer timer(M_REWRITE);
+    ProcessLock files;
+    lockFiles(files, false);
+    CheckpointImage image = renderCheckpoint();
+    writeCheckpoint(image);
+    installCheckpoint(image);
+    journal.reset();
+}
+void Registry::startCheckpoint() {
+    if (checkpointRunning) return;
+    if (checkpointer.joinable()) checkpointer.join();
+    // A read-only loader holds the files; the next mutation tries again
+    ProcessLock rotating;
+    if (!rotating.acquire("checkpoint.lock", false, false)) return;
+    absorbSources();
+    CheckpointImage image = renderCheckpoint();
+    if (!journal.rotate()) {
+        // An earlier one failed and left its rotated journal: write in place
+        MetricTimer timer(M_REWRITE);
+        writeCheckpoint(image);
+        installCheckpoint(image);
+        journal.reset();
+        return;
+    }
+    checkpointRunning = true;
+    checkpointer = thread([this, image = move(image)]() mutable {
+        bool ok = true;
+        try {
+            ProcessLock files;
+            lockFiles(files, false);
+            MetricTimer timer(M_REWRITE);
+            writeCheckpoint(image);
+            journal.dropRotated();
+        } catch (const exception& ex) {
+            // Its entries stay in the rotated journal for the next one
+            ok = false;
+            Logger::getInstance()->log(string("Checkpoint failed: ") + ex.what());
+        }
+        {
+            unique_lock<shared_mutex> lock(rw);
+            if (ok) installCheckpoint(image);
+            checkpointRunning = false;
+        }
+        checkpointDone.notify_all();
+    });
+}
+uint64_t Registry::record(int op, initializer_list<string_view> fields) {
+    if (readOnly) throw runtime_error("Data files are in use by another process; this copy is read-only");
+    uint64_t seq = journal.stage(op, fields);
+    if (grouping) return 0;
+    if (journal.entryCount() >= CHECKPOINT_ENTRIES || journal.byteCount() >= CHECKPOINT_BYTES) startCheckpoint();
+    return seq;
+}
+void Registry::applyEntry(const JournalEntry& e) {
+    const vector<string>& f = e.fields;
+    switch (e.op) {
+        case J_ADD_STUDENT:
+            if (f.size() == 6) applyAddStudent({f[0], f[1], f[2], f[3], f[4], f[5]});
+            break;
+        case J_UPDATE_STUDENT:
+            if (f.size() == 6) applyUpdateStudent({f[0], f[1], f[2], f[3], f[4], f[5]});
+            break;
+        case J_REMOVE_STUDENT:
+            if (f.size() == 1) applyRemoveStudent(f[0]);
+            break;
+        case J_ADD_COURSE:
+            if (f.size() >= 3) applyAddCourse({f[0], f[1], f[2], f.size() > 3 ? f[3] : "0"});
+            break;
+        case J_UPDATE_COURSE:
+            if (f.size() >= 3) applyUpdateCourse({f[0], f[1], f[2], f.size() > 3 ? f[3] : "0"});
+            break;
+        case J_REMOVE_COURSE:
+            if (f.size() == 1) applyRemoveCourse(f[0]);
+            break;
+        case J_ENROLL:
+            if (f.size() == 2) applyEnroll(f[0], f[1]);
+            break;
+        case J_DROP:
+            if (f.size() == 2) applyDrop(f[0], f[1]);
+            break;
+    }
+}
+void Registry::applyAddStudent(const StudentRecord& s) {
+    if (applyUpdateStudent(viewOf(s))) return;
+    students.append(s);
+    studentLive.push_back(1);
+    studentCourses.addRow();
+    studentIds.insert(s.id, (uint32_t)(students.size() - 1));
+    indexStudent((uint32_t)(students.size() - 1));
+}
+void Registry::applyAddCourse(const CourseRecord& c) {
+    if (applyUpdateCourse(c)) return;
+    courses.push_back(c);
+    courseLive.push_back(1);
+    courseStudents.addRow();
+    if (pendingSeats.size() < courses.size()) pendingSeats.emplace_back(0);
+    courseCodes.insert(c.code, (uint32_t)(courses.size() - 1));
+    if (textLive()) courseText.insert((uint32_t)(courses.size() - 1), searchText(c));
+}
+bool Registry::applyUpdateStudent(const StudentView& s) {
+    long i = studentIndex(s.id);
+    if (i < 0) return false;
+    // The ID is the key and never changes; keep the stored spelling
+    StudentView stored = s;
+    stored.id = students.id(i);
+    unindexStudent((uint32_t)i);
+    students.assign(i, stored);
+    indexStudent((uint32_t)i);
+    return true;
+}
+bool Registry::applyUpdateCourse(const CourseRecord& c) {
+    long i = courseIndex(c.code);
+    if (i < 0) return false;
+    string code = courses[i].code;
+    if (textLive()) courseText.erase((uint32_t)i);
+    courses[i] = c;
+    courses[i].code = code;
+    if (textLive()) courseText.insert((uint32_t)i, searchText(courses[i]));
+    return true;
+}
+bool Registry::applyRemoveStudent(const string& id) {
+    long i = studentIndex(id);
+    if (i < 0) return false;
+    // Cascade: unlink the student from each of their courses' rosters
+    vector<uint32_t>& list = studentCourses.edit(i);
+    for (size_t j = 0; j < list.size(); ++j) eraseSorted(courseStudents.edit(list[j]), (uint32_t)i);
+    enrollmentCount -= list.size();
+    vector<uint32_t>().swap(list);
+    unindexStudent((uint32_t)i);
+    studentIds.erase(students.id(i), (uint32_t)i);
+    studentLive[i] = 0;
+    if (++deadStudents > 64 && deadStudents * 2 > students.size()) compactStudents();
+    return true;
+}
+bool Registry::applyRemoveCourse(const string& code) {
+    long i = courseIndex(code);
+    if (i < 0) return false;
+    vector<uint32_t>& list = courseStudents.edit(i);
+    for (size_t j = 0; j < list.size(); ++j) eraseSorted(studentCourses.edit(list[j]), (uint32_t)i);
+    enrollmentCount -= list.size();
+    vector<uint32_t>().swap(list);
+    courseCodes.erase(courses[i].code, (uint32_t)i);
+    if (textLive()) courseText.erase((uint32_t)i);
+    courseLive[i] = 0;
+    if (++deadCourses > 64 && deadCourses * 2 > courses.size()) compactCourses();
+    return true;
+}
+bool Registry::applyEnroll(string_view sid, string_view code) {
+    long s = studentIndex(sid), c = courseIndex(code);
+    if (s < 0 || c < 0) return false;
+    if (!insertSorted(studentCourses.edit(s), (uint32_t)c)) return false;
+    insertSorted(courseStudents.edit(c), (uint32_t)s);
+    ++enrollmentCount;
+    return true;
+}
+bool Registry::applyDrop(string_view sid, string_view code) {
+    long s = studentIndex(sid), c = courseIndex(code);
+    if (s < 0 || c < 0) return false;
+    if (!eraseSorted(studentCourses.edit(s), (uint32_t)c)) return false;
+    eraseSorted(courseStudents.edit(c), (uint32_t)s);
+    --enrollmentCount;
+    return true;
+}
+Registry* Registry::instance = nullptr;
+
+// --- Source watcher: keeps the Registry current with outside edits ---
+SourceWatcher::SourceWatcher() : stopping(false), notifyFd(-1) {
+#ifndef _WIN32
+    stopPipe[0] = stopPipe[1] = -1;
+#endif
+}
+void SourceWatcher::refresh() {
+    try {
+        SourceRefresh r = Registry::getInstance()->refreshSources();
+        if (r.reloaded) Logger::getInstance()->log("Data files were replaced by another program; reloaded them");
+        else if (r.rows) Logger::getInstance()->log("Read " + to_string(r.rows) + " row(s) appended to the data files by another program");
+    } catch (const exception& ex) {
+        Logger::getInstance()->log(string("Cannot read changed data files: ") + ex.what());
+    }
+}
+#ifdef __linux__
+bool SourceWatcher::drainEvents() {
+    alignas(inotify_event) char buf[4096];
+    bool relevant = false;
+    while (true) {
+        ssize_t n = ::read(notifyFd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (ssize_t at = 0; at < n;) {
+            const inotify_event* e = (const inotify_event*)(buf + at);
+            if (e->mask & IN_Q_OVERFLOW) relevant = true;
+            for (int i = 0; i < 3 && e->len; ++i)
+                if (strcmp(e->name, SNAP_SOURCES[i]) == 0) relevant = true;
+            at += (ssize_t)(sizeof(inotify_event) + e->len);
+        }
+    }
+    return relevant;
+}
+void SourceWatcher::runNotify() {
+    while (true) {
+        pollfd fds[2] = {{notifyFd, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+        int ready = ::poll(fds, 2, SAFETY_POLL_MS);
+        if (ready < 0 && errno != EINTR) break;
+        if (fds[1].revents) break;
+        if (ready == 0) {
+            refresh();
+            continue;
+        }
+        if (!(fds[0].revents & POLLIN) || !drainEvents()) continue;
+        this_thread::sleep_for(chrono::milliseconds(SETTLE_MS));
+        drainEvents();
+        refresh();
+    }
+}
+#endif
+void SourceWatcher::runPoll() {
+    unique_lock<mutex> lock(m);
+    while (!stopping) {
+        if (wake.wait_for(lock, chrono::milliseconds(POLL_MS), [this] { return stopping; })) break;
+        lock.unlock();
+        refresh();
+        lock.lock();
+    }
+}
+SourceWatcher* SourceWatcher::getInstance() {
+    if (!instance) {
+        instance = new SourceWatcher();
+        atexit([] { instance->shutdown(); });
+    }
+    return instance;
+}
+void SourceWatcher::start() {
+    lock_guard<mutex> lock(m);
+    if (worker.joinable() || stopping) return;
+#ifdef __linux__
+    notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notifyFd >= 0 && (pipe(stopPipe) != 0 ||
+                          inotify_add_watch(notifyFd, ".", IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)) {
+        close(notifyFd);
+        notifyFd = -1;
+    }
+    if (notifyFd >= 0) {
+        worker = thread(&SourceWatcher::runNotify, this);
+        return;
+    }
+#endif
+    worker = thread(&SourceWatcher::runPoll, this);
+}
+void SourceWatcher::shutdown() {
+    {
+        lock_guard<mutex> lock(m);
+        if (stopping) return;
+        stopping = true;
+    }
+    wake.notify_one();
+#ifndef _WIN32
+    if (stopPipe[1] >= 0) {
+        ssize_t n = ::write(stopPipe[1], "x", 1);
+        (void)n;
+    }
+#endif
+    if (worker.joinable()) worker.join();
+}
+SourceWatcher* SourceWatcher::instance = nullptr;
+
+// --- Credential store: password hashes for every account, by case-folded ID ---
+CredentialStore::CredentialStore() {
+    random_device rd;
+    for (int i = 0; i < 32; i += 4) {
+        uint32_t r = rd();
+        memcpy(cacheKey + i, &r, 4);
+    }
+    vector<pair<string, string> > rows;
+    RecordFiles::loadCredentials(rows);
+    for (size_t i = 0; i < rows.size(); ++i)
+        if (equalsIgnoreCase(rows[i].first, "admin")) adminHash = rows[i].second;
+    if (adminHash.empty()) {
+        adminHash = hashPassword("admin123");
+        rows.push_back({"admin", adminHash});
+        RecordFiles::saveCredentials(rows);
+    }
+    dummyHash = hashPassword("");
+}
+string CredentialStore::cacheDigest(const string& stored, const string& password) {
+    Sha256 h;
+    h.update(cacheKey, sizeof(cacheKey));
+    h.update(stored.data(), stored.size());
+    h.update("", 1);
+    h.update(password.data(), password.size());
+    uint8_t d[32];
+    h.final(d);
+    return string((const char*)d, 32);
+}
+bool CredentialStore::verify(const string& key, const string& stored, const string& password) {
+    string digest = cacheDigest(stored, password);
+    {
+        lock_guard<mutex> lock(cacheLock);
+        auto it = verified.find(key);
+        if (it != verified.end() && constantTimeEquals(it->second, digest)) return true;
+    }
+    if (!checkPassword(stored, password)) return false;
+    lock_guard<mutex> lock(cacheLock);
+    if (verified.size() >= CACHE_LIMIT) verified.clear();
+    verified[key] = digest;
+    return true;
+}
+CredentialStore* CredentialStore::getInstance() {
+    if (!instance)
+        instance = new CredentialStore();
+    return instance;
+}
+CredentialStore::Access CredentialStore::login(const string& username, const string& password, StudentRecord& s) {
+    if (isReservedId(username)) return verify("admin", adminHash, password) ? ADMIN_ACCESS : NO_ACCESS;
+    Registry* reg = Registry::getInstance();
+    if (!reg->findStudent(username, s)) {
+        checkPassword(dummyHash, password);
+        return NO_ACCESS;
+    }
+    if (!verify(foldCase(s.id), s.password, password)) return NO_ACCESS;
+    if (!isHashedPassword(s.password)) {
+        s.password = hashPassword(password);
+        // The upgrade stays queued if the journal is failing; no reason to refuse the login
+        try {
+            reg->updateStudent(s);
+        } catch (const JournalError& ex) {
+            Logger::getInstance()->log(string("Password upgrade for ") + s.id + " not saved yet: " + ex.what());
+        }
+    }
+    return STUDENT_ACCESS;
+}
+CredentialStore* CredentialStore::instance = nullptr;
+int runMigratePasswords(size_t threads) {
+    Registry* reg = Registry::getInstance();
+    vector<StudentRecord> plain;
+    reg->forEachStudent([&plain](const StudentView& s) {
+        if (!isHashedPassword(string(s.password))) plain.push_back(s.record());
+    });
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.push_back(thread([&plain, t, threads]() {
+            for (size_t i = plain.size() * t / threads; i < plain.size() * (t + 1) / threads; ++i)
+                plain[i].password = hashPassword(plain[i].password);
+        }));
+    }
+    for (size_t t = 0; t < threads; ++t) workers[t].join();
+    reg->beginGroup();
+    for (size_t i = 0; i < plain.size(); ++i) reg->updateStudent(plain[i]);
+    reg->commitGroup();
+    reg->checkpoint();
+    Logger::getInstance()->log("Admin hashed " + to_string(plain.size()) + " plaintext passwords");
+    cout << plain.size() << " passwords hashed in " << fixed << setprecision(3)
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s\n";
+    return 0;
+}
+
+// --- Login throttling: failed attempts per username and per source ---
+size_t SlidingSketch::column(uint32_t h, size_t row) const {
+    uint32_t h2 = (h >> 16 | h << 16) * 0x9E3779B1u | 1;
+    return (h + (uint32_t)row * h2) % COLS;
+}
+uint32_t SlidingSketch::countIn(int half, uint32_t h) const {
+    uint32_t c = UINT32_MAX;
+    for (size_t r = 0; r < ROWS; ++r) c = min(c, cells[half][r][column(h, r)]);
+    return c;
+}
+int SlidingSketch::half(int64_t window) {
+    int i = (int)(window & 1);
+    if (windowOf[i] != window) {
+        memset(cells[i], 0, sizeof(cells[i]));
+        windowOf[i] = window;
+    }
+    return i;
+}
+SlidingSketch::SlidingSketch(int64_t seconds) : windowSecs(seconds) {
+    memset(cells, 0, sizeof(cells));
+    memset(until, 0, sizeof(until));
+    windowOf[0] = windowOf[1] = -1;
+}
+void SlidingSketch::add(uint32_t h, int64_t nowMs) {
+    int i = half(nowMs / 1000 / windowSecs);
+    for (size_t r = 0; r < ROWS; ++r) ++cells[i][r][column(h, r)];
+}
+double SlidingSketch::estimate(uint32_t h, int64_t nowMs) {
+    int64_t window = nowMs / 1000 / windowSecs;
+    double cur = countIn(half(window), h);
+    int prev = (int)((window - 1) & 1);
+    if (windowOf[prev] != window - 1) return cur;
+    double elapsed = (double)(nowMs - window * windowSecs * 1000) / (windowSecs * 1000);
+    return cur + countIn(prev, h) * (1.0 - elapsed);
+}
+void SlidingSketch::holdUntil(uint32_t h, int64_t deadlineMs) {
+    for (size_t r = 0; r < ROWS; ++r) until[r][column(h, r)] = max(until[r][column(h, r)], deadlineMs);
+}
+int64_t SlidingSketch::heldUntil(uint32_t h) const {
+    int64_t t = INT64_MAX;
+    for (size_t r = 0; r < ROWS; ++r) t = min(t, until[r][column(h, r)]);
+    return t;
+}
+int64_t LoginThrottle::nowMs() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+int64_t LoginThrottle::backoff(double failures, unsigned free) {
+    if (failures < free) return 0;
+    int64_t excess = (int64_t)(failures - free);
+    return excess >= 7 ? MAX_DELAY_MS : min(MAX_DELAY_MS, BASE_DELAY_MS << excess);
+}
+LoginThrottle* LoginThrottle::getInstance() {
+    if (!instance)
+        instance = new LoginThrottle();
+    return instance;
+}
+int64_t LoginThrottle::delayFor(const string& username, const string& source) {
+    lock_guard<mutex> guard(lock);
+    int64_t until = max(userFailures.heldUntil(hashFolded(trim(username))), sourceFailures.heldUntil(hashFolded(source)));
+    return max((int64_t)0, until - nowMs());
+}
+void LoginThrottle::recordFailure(const string& username, const string& source) {
+    lock_guard<mutex> guard(lock);
+    int64_t now = nowMs();
+    uint32_t user = hashFolded(trim(username)), from = hashFolded(source);
+    userFailures.add(user, now);
+    sourceFailures.add(from, now);
+    userFailures.holdUntil(user, now + backoff(userFailures.estimate(user, now), USER_FREE));
+    sourceFailures.holdUntil(from, now + backoff(sourceFailures.estimate(from, now), SOURCE_FREE));
+}
+LoginThrottle* LoginThrottle::instance = nullptr;
+
+// --- Console: each session reads and writes its own streams ---
+thread_local istream* sessionIn = &cin;
+thread_local ostream* sessionOut = &cout;
+thread_local string sessionSource = "console";
+istream& termIn() { return *sessionIn; }
+ostream& termOut() { return *sessionOut; }
+
+// --- Display Strategy Pattern ---
+string seatText(const CourseRecord& c, size_t taken) {
+    uint32_t limit = seatLimit(c);
+    return limit ? to_string(taken) + "/" + to_string(limit) : to_string(taken);
+}
+void appendCell(string& out, const string& s, size_t width) {
+    out += s;
+    if (s.size() < width) out.append(width - s.size(), ' ');
+}
+string DisplayStrategy::sortKey(string_view id, string_view name, SortKey sort) {
+    // IDs are unique case-insensitively, so appending one makes any key unique
+    return sort == SORT_ID ? foldCase(id) : foldCase(name) + '\x01' + foldCase(id);
+}
+string DisplayStrategy::studentKey(const StudentView& s, SortKey sort) {
+    if (sort != SORT_AGE) return sortKey(s.id, s.name, sort);
+    char age[16];
+    snprintf(age, sizeof(age), "%05d", ageValue(s.age) + 1);
+    return age + ('\x01' + foldCase(s.id));
+}
+PageResult DisplayStrategy::studentPage(const PageRequest& page, vector<StudentRecord>& rows) {
+    const StudentFilter* filter = page.filter;
+    const string& course = page.course;
+    return collect(page,
+                   [filter, &course](auto fn) {
+                       if (!course.empty()) Registry::getInstance()->forEachInCourse(course, fn);
+                       else if (filter) Registry::getInstance()->forEachMatch(*filter, fn);
+                       else Registry::getInstance()->forEachStudent(fn);
+                   },
+                   [filter](PageRequest& at, auto fn) {
+                       if (!at.course.empty()) {
+                           Registry::getInstance()->resumeCourse(at.course, at.slot, at.layout, at.offset, fn);
+                           return;
+                       }
+                       if (!filter) {
+                           Registry::getInstance()->resumeStudents(at.slot, at.layout, at.offset, fn);
+                           return;
+                       }
+                       // Matches come in index order, not slot order, so they resume by offset
+                       size_t seen = 0;
+                       bool open = true;
+                       Registry::getInstance()->forEachMatch(*filter, [&](const StudentView& s) {
+                           if (open && seen++ >= at.offset) open = fn(s);
+                       });
+                   },
+                   studentKey, rows);
+}
+PageResult DisplayStrategy::coursePage(const PageRequest& page, vector<CourseRow>& rows) {
+    return collect(page,
+                   [](auto fn) {
+                       Registry::getInstance()->forEachCourseSeats(
+                           [&fn](const CourseRecord& c, size_t taken) { fn(CourseRow{c, taken}); });
+                   },
+                   [](PageRequest& at, auto fn) {
+                       Registry::getInstance()->resumeCourseSeats(
+                           at.slot, at.layout, at.offset, [&fn](const CourseRecord& c, size_t taken) { return fn(CourseRow{c, taken}); });
+                   },
+                   [](const CourseRow& r, SortKey sort) { return sortKey(r.course.code, r.course.name, sort); }, rows);
+}
+void DisplayStrategy::write(const string& out) {
+    termOut().write(out.data(), (streamsize)out.size());
+    termOut().flush();
+}
+PageResult TableView::displayStudents(const PageRequest& page) {
+    vector<StudentRecord> rows;
+    PageResult r = studentPage(page, rows);
+    string out;
+    out.reserve(2 * 86 + rows.size() * 86);
+    out += "\n";
+    appendCell(out, "ID", 12);
+    appendCell(out, "Name", 22);
+    appendCell(out, "Email", 28);
+    appendCell(out, "Age", 6);
+    appendCell(out, "Program", 16);
+    out += "\n";
+    out.append(84, '-');
+    out += "\n";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        appendCell(out, rows[i].id, 12);
+        appendCell(out, rows[i].name, 22);
+        appendCell(out, rows[i].email, 28);
+        appendCell(out, rows[i].age, 6);
+        appendCell(out, rows[i].program, 16);
+        out += "\n";
+    }
+    write(out);
+    return r;
+}
+PageResult TableView::displayCourses(const PageRequest& page) {
+    vector<CourseRow> rows;
+    PageResult r = coursePage(page, rows);
+    string out;
+    out.reserve(2 * 66 + rows.size() * 66);
+    out += "\n";
+    appendCell(out, "Code", 12);
+    appendCell(out, "Name", 32);
+    appendCell(out, "Units", 8);
+    appendCell(out, "Seats", 12);
+    out += "\n";
+    out.append(64, '-');
+    out += "\n";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const CourseRecord& c = rows[i].course;
+        appendCell(out, c.code, 12);
+        appendCell(out, c.name, 32);
+        appendCell(out, c.units, 8);
+        appendCell(out, seatText(c, rows[i].taken), 12);
+        out += "\n";
+    }
+    write(out);
+    return r;
+}
+PageResult SummaryView::displayStudents(const PageRequest& page) {
+    vector<StudentRecord> rows;
+    PageResult r = studentPage(page, rows);
+    string out;
+    out.reserve(32 + rows.size() * 40);
+    out += "\nStudent IDs and Names:\n";
+    for (size_t i = 0; i < rows.size(); ++i) out += rows[i].id + " - " + rows[i].name + "\n";
+    write(out);
+    return r;
+}
+PageResult SummaryView::displayCourses(const PageRequest& page) {
+    vector<CourseRow> rows;
+    PageResult r = coursePage(page, rows);
+    string out;
+    out.reserve(32 + rows.size() * 40);
+    out += "\nCourse Codes and Names:\n";
+    for (size_t i = 0; i < rows.size(); ++i) out += rows[i].course.code + " - " + rows[i].course.name + "\n";
+    write(out);
+    return r;
+}
+bool isJsonNumber(string_view s) {
+    if (s.empty() || (s[0] == '0' && s.size() > 1)) return false;
+    for (size_t i = 0; i < s.size(); ++i)
+        if (s[i] < '0' || s[i] > '9') return false;
+    return true;
+}
+void appendJsonString(string& out, string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.append(s.data() + run, i - run);
+        run = i + 1;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+    out.append(s.data() + run, s.size() - run);
+    out += '"';
+}
+void appendCsvField(string& out, string_view s) {
+    if (s.find_first_of(",\"\r\n") == string_view::npos) {
+        out.append(s.data(), s.size());
+        return;
+    }
+    out += '"';
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '"') out += '"';
+        out += s[i];
+    }
+    out += '"';
+}
+RecordEncoder::RecordEncoder(OutputFormat f, const char* const* fieldNames, const bool* numericFields, size_t fieldCount)
+    : format(f), names(fieldNames), numeric(numericFields), fields(fieldCount), rows(0) {}
+void RecordEncoder::begin(string& out) {
+    if (format == FORMAT_JSON) {
+        out += '[';
+    } else if (format == FORMAT_CSV) {
+        for (size_t i = 0; i < fields; ++i) {
+            if (i) out += ',';
+            out += names[i];
+        }
+        out += '\n';
+    }
+}
+void RecordEncoder::row(string& out, const string_view* values) {
+    if (format == FORMAT_CSV) {
+        for (size_t i = 0; i < fields; ++i) {
+            if (i) out += ',';
+            appendCsvField(out, values[i]);
+        }
+        out += '\n';
+    } else {
+        if (format == FORMAT_JSON) out += rows ? ",\n" : "\n";
+        out += '{';
+        for (size_t i = 0; i < fields; ++i) {
+            if (i) out += ',';
+            out += '"';
+            out += names[i];
+            out += "\":";
+            if (numeric[i] && isJsonNumber(values[i])) out.append(values[i].data(), values[i].size());
+            else appendJsonString(out, values[i]);
+        }
+        out += '}';
+        if (format == FORMAT_NDJSON) out += '\n';
+    }
+    ++rows;
+}
+void RecordEncoder::end(string& out) {
+    if (format == FORMAT_JSON) out += rows ? "\n]\n" : "]\n";
+}
+void encodeStudent(RecordEncoder& enc, string& out, const StudentView& s) {
+    string_view v[5] = {s.id, s.name, s.email, s.age, s.program};
+    enc.row(out, v);
+}
+void encodeCourse(RecordEncoder& enc, string& out, const CourseRecord& c, size_t taken) {
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%zu", taken);
+    string_view v[5] = {c.code, c.name, c.units, c.capacity, string_view(num, (size_t)n)};
+    enc.row(out, v);
+}
+PageResult FormatView::displayStudents(const PageRequest& page) {
+    vector<StudentRecord> rows;
+    PageResult r = studentPage(page, rows);
+    RecordEncoder enc(format, STUDENT_FIELDS, STUDENT_NUMERIC, 5);
+    string out;
+    out.reserve(64 + rows.size() * 128);
+    enc.begin(out);
+    for (size_t i = 0; i < rows.size(); ++i) encodeStudent(enc, out, viewOf(rows[i]));
+    enc.end(out);
+    write(out);
+    return r;
+}
+PageResult FormatView::displayCourses(const PageRequest& page) {
+    vector<CourseRow> rows;
+    PageResult r = coursePage(page, rows);
+    RecordEncoder enc(format, COURSE_FIELDS, COURSE_NUMERIC, 5);
+    string out;
+    out.reserve(64 + rows.size() * 96);
+    enc.begin(out);
+    for (size_t i = 0; i < rows.size(); ++i) encodeCourse(enc, out, rows[i].course, rows[i].taken);
+    enc.end(out);
+    write(out);
+    return r;
+}
+thread_local DisplayStrategy* displayStrategy = nullptr;
+void chooseDisplayStrategy() {
+    int opt = 0;
+    do {
+        termOut() << "\nChoose display format:\n";
+        termOut() << "1. Table View\n";
+        termOut() << "2. Summary View\n";
+        termOut() << "3. JSON\n";
+        termOut() << "4. NDJSON (one object per line)\n";
+        termOut() << "5. CSV\n";
+        termOut() << "Select option: ";
+        string input;
+        readLine(input);
+
+        // Validation: must be exactly one digit from 1 to 5
+        if (input.size() == 1 && input[0] >= '1' && input[0] <= '5') {
+            opt = stoi(input);
+        } else {
+            termOut() << "Invalid input. Please enter 1 to 5 only.\n";
+            continue;
+        }
+
+        if (displayStrategy) delete displayStrategy;
+        if (opt == 2)
+            displayStrategy = new SummaryView();
+        else if (opt == 3)
+            displayStrategy = new FormatView(FORMAT_JSON);
+        else if (opt == 4)
+            displayStrategy = new FormatView(FORMAT_NDJSON);
+        else if (opt == 5)
+            displayStrategy = new FormatView(FORMAT_CSV);
+        else
+            displayStrategy = new TableView();
+        break;
+    } while (true);
+}
+User::User(const string& id, const string& name, const string& email, const string& password)
+    : id(id), name(name), email(email), password(password) {}
+Admin::Admin(const string& id, const string& name, const string& email, const string& password)
+    : User(id, name, email, password) {}
+void Admin::menu() {
+    termOut() << "\n--- Admin Menu ---\n";
+    termOut() << "1. Add Student\n";
+    termOut() << "2. Add Course\n";
+    termOut() << "3. View All Students\n";
+    termOut() << "4. View All Courses\n";
+    termOut() << "5. View Students per Course\n";
+    termOut() << "6. Edit Student\n";
+    termOut() << "7. Edit Course\n";
+    termOut() << "8. Delete Student\n";
+    termOut() << "9. Delete Course\n";
+    termOut() << "10. Change Display Mode\n";
+    termOut() << "11. Logout\n";
+    termOut() << "12. Find Students\n";
+}
+Student::Student(const string& id, const string& name, const string& email, const string& password)
+    : User(id, name, email, password) {}
+void Student::menu() {
+    termOut() << "\n--- Student Menu ---\n";
+    termOut() << "1. View Profile\n";
+    termOut() << "2. Enroll in Course\n";
+    termOut() << "3. View Enrolled Courses\n";
+    termOut() << "4. Edit Profile\n";
+    termOut() << "5. Drop Course\n";
+    termOut() << "6. Change Display Mode\n";
+    termOut() << "7. Logout\n";
+}
+
+// --- Lookup helpers (answered from the Registry) ---
+bool studentExists(const string& id) {
+    StudentRecord s;
+    return Registry::getInstance()->findStudent(id, s) && s.id == id;
+}
+bool courseExists(const string& code) {
+    CourseRecord c;
+    return Registry::getInstance()->findCourse(code, c) && c.code == code;
+}
+bool isEnrolled(string_view sid, string_view ccode) {
+    return Registry::getInstance()->isEnrolled(sid, ccode);
+}
+void suggestStudents(string_view input) {
+    vector<StudentRecord> found = Registry::getInstance()->searchStudents(input, SUGGESTIONS);
+    if (found.empty()) return;
+    termOut() << "Did you mean:\n";
+    for (size_t i = 0; i < found.size(); ++i)
+        termOut() << "  " << found[i].id << " - " << found[i].name << " (" << found[i].email << ")\n";
+}
+void suggestCourses(string_view input) {
+    vector<CourseRecord> found = Registry::getInstance()->searchCourses(input, SUGGESTIONS);
+    if (found.empty()) return;
+    termOut() << "Did you mean:\n";
+    for (size_t i = 0; i < found.size(); ++i) termOut() << "  " << found[i].code << " - " << found[i].name << "\n";
+}
+
+// --- Helpers for validation and case-insensitive checks ---
+bool isAlphanumeric(string_view s) {
+    return !s.empty() && textKernels.inClass(s.data(), s.size(), CLASS_ALNUM);
+}
+bool isLettersOnly(string_view s) {
+    return !s.empty() && textKernels.inClass(s.data(), s.size(), CLASS_LETTERS);
+}
+bool isWholeNumber(string_view s) {
+    return !s.empty() && textKernels.inClass(s.data(), s.size(), CLASS_DIGITS);
+}
+bool studentExistsCI(string_view id) {
+    return Registry::getInstance()->hasStudent(id);
+}
+bool courseExistsCI(string_view code) {
+    return Registry::getInstance()->hasCourse(code);
+}
+
+// --- Record validation (shared by the menus and batch mode) ---
+string checkNewStudentId(const string& id) {
+    if (id.size() > MAX_ID_LEN) return "Student ID must be at most " + to_string(MAX_ID_LEN) + " characters.";
+    if (id.find(' ') != string::npos) return "Student ID must not contain spaces.";
+    if (!isAlphanumeric(id)) return "Student ID must be strictly alphanumeric.";
+    if (CredentialStore::isReservedId(id)) return "Student ID \"admin\" is reserved.";
+    if (studentExistsCI(id)) return "Student ID already exists.";
+    return "";
+}
+string checkNewCourseCode(const string& code) {
+    if (code.size() > MAX_ID_LEN) return "Course code must be at most " + to_string(MAX_ID_LEN) + " characters.";
+    if (code.find(' ') != string::npos) return "Course code must not contain spaces.";
+    if (!isAlphanumeric(code)) return "Course code must be strictly alphanumeric.";
+    if (courseExistsCI(code)) return "Course code already exists (case-insensitive).";
+    return "";
+}
+string checkName(const string& name) {
+    return isLettersOnly(name) ? "" : "Name should be letters only.";
+}
+string checkAge(const string& age) {
+    return isWholeNumber(age) ? "" : "Age should be a whole number.";
+}
+string checkUnits(const string& units) {
+    return isWholeNumber(units) ? "" : "Units should be a whole number.";
+}
+string checkCapacity(const string& capacity) {
+    if (!isWholeNumber(capacity) || capacity.size() > 9) return "Capacity should be a whole number (0 for no limit).";
+    return "";
+}
+string checkCapacityFor(const string& code, const string& capacity) {
+    string err = checkCapacity(capacity);
+    if (!err.empty()) return err;
+    size_t enrolled = Registry::getInstance()->rosterSize(code), cap = strtoul(capacity.c_str(), nullptr, 10);
+    if (cap && cap < enrolled) return "Capacity cannot be below the " + to_string(enrolled) + " students already enrolled.";
+    return "";
+}
+string checkFreeText(const string& label, const string& s) {
+    if (s.find_first_of(",\r\n") != string::npos) return label + " must not contain commas or line breaks.";
+    return "";
+}
+
+// --- Admin Features ---
+void addStudent() {
+    string id, name, email, age, program, password;
+
+    // Student ID input and validation
+    bool validId = false;
+    do {
+        termOut() << "Enter Student ID: ";
+        readLine(id);
+        string err = checkNewStudentId(id);
+        if (!err.empty()) {
+            termOut() << err << "\n";
+        } else {
+            validId = true;
+        }
+    } while (!validId);
+
+    // Name input and validation
+    bool validName = false;
+    do {
+        termOut() << "Enter Name: ";
+        readLine(name);
+        if (!isLettersOnly(name)) {
+            termOut() << "Name should be letters only.\n";
+        } else {
+            validName = true;
+        }
+    } while (!validName);
+
+    termOut() << "Enter Email: ";
+    readLine(email);
+
+    // Age input and validation
+    bool validAge = false;
+    do {
+        termOut() << "Enter Age: ";
+        readLine(age);
+        if (!isWholeNumber(age)) {
+            termOut() << "Age should be a whole number.\n";
+        } else {
+            validAge = true;
+        }
+    } while (!validAge);
+
+    termOut() << "Enter Program: ";
+    readLine(program);
+    termOut() << "Enter Password: ";
+    readLine(password);
+
+    Registry::getInstance()->addStudent({id, name, email, age, program, hashPassword(password)});
+    Logger::getInstance()->event(A_ADD_STUDENT, "admin", id);
+    termOut() << "Student added.\n";
+}
+void addCourse() {
+    string code, name, units, capacity;
+    bool validCode = false;
+    do {
+        termOut() << "Enter Course Code: ";
+        readLine(code);
+        string err = checkNewCourseCode(code);
+        if (!err.empty()) {
+            termOut() << err << "\n";
+        } else {
+            validCode = true;
+        }
+    } while (!validCode);
+
+    termOut() << "Enter Course Name: ";
+    readLine(name);
+
+    bool validUnits = false;
+    do {
+        termOut() << "Enter Units: ";
+        readLine(units);
+        if (!isWholeNumber(units)) {
+            termOut() << "Units should be a whole number.\n";
+        } else {
+            validUnits = true;
+        }
+    } while (!validUnits);
+
+    do {
+        termOut() << "Enter Capacity (0 for no limit): ";
+        readLine(capacity);
+        string err = checkCapacity(capacity);
+        if (err.empty()) break;
+        termOut() << err << "\n";
+    } while (true);
+
+    Registry::getInstance()->addCourse({code, name, units, capacity});
+    Logger::getInstance()->event(A_ADD_COURSE, "admin", code);
+    termOut() << "Course added.\n";
+}
+void viewAllStudents() {
+    if (!displayStrategy) chooseDisplayStrategy();
+    pageThrough([](const PageRequest& page) { return displayStrategy->displayStudents(page); });
+}
+void viewAllCourses() {
+    if (!displayStrategy) chooseDisplayStrategy();
+    pageThrough([](const PageRequest& page) { return displayStrategy->displayCourses(page); });
+}
+void findStudents() {
+    StudentFilter f = {"", -1, -1, ""};
+    string input;
+    termOut() << "Program (blank for any): ";
+    readLine(input);
+    f.program = trim(input);
+    do {
+        termOut() << "Minimum age (blank for none): ";
+        readLine(input);
+        input = trim(input);
+        if (input.empty()) break;
+        if (ageValue(input) >= 0) {
+            f.minAge = ageValue(input);
+            break;
+        }
+        termOut() << "Age should be a whole number.\n";
+    } while (true);
+    do {
+        termOut() << "Maximum age (blank for none): ";
+        readLine(input);
+        input = trim(input);
+        if (input.empty()) break;
+        if (ageValue(input) >= 0) {
+            f.maxAge = ageValue(input);
+            break;
+        }
+        termOut() << "Age should be a whole number.\n";
+    } while (true);
+    termOut() << "Name starts with (blank for any): ";
+    readLine(input);
+    f.namePrefix = trim(input);
+
+    SortKey order;
+    do {
+        termOut() << "Order by: 1. Name  2. Age  3. ID: ";
+        readLine(input);
+        if (input == "1" || input == "2" || input == "3") {
+            order = input == "1" ? SORT_NAME : input == "2" ? SORT_AGE : SORT_ID;
+            break;
+        }
+        termOut() << "Invalid input. Please enter 1 to 3 only.\n";
+    } while (true);
+
+    if (!displayStrategy) chooseDisplayStrategy();
+    pageThrough([](const PageRequest& page) { return displayStrategy->displayStudents(page); },
+                {order, 0, PAGE_ROWS, "", &f, 0, 0, ""});
+}
+void viewStudentsPerCourse(RequestArena& arena) {
+    pmr::string inputCode(arena.resource());
+    bool valid = false;
+    do {
+        termOut() << "Enter Course Code: ";
+        readLine(inputCode);
+
+        if (!courseExistsCI(inputCode)) {
+            termOut() << "Course not found. Please try again.\n";
+            suggestCourses(inputCode);
+        } else {
+            valid = true;
+        }
+    } while (!valid);
+
+    if (Registry::getInstance()->rosterSize(inputCode) == 0) {
+        termOut() << "No students enrolled in this course.\n";
+        return;
+    }
+    termOut() << "Students enrolled in " << inputCode << ":\n";
+    if (!displayStrategy) chooseDisplayStrategy();
+    pageThrough([](const PageRequest& page) { return displayStrategy->displayStudents(page); },
+                {SORT_STORED, 0, PAGE_ROWS, "", nullptr, 0, 0, string(inputCode)});
+}
+void editStudent(RequestArena& arena) {
+    pmr::string id(arena.resource());
+    bool found = false;
+    do {
+        termOut() << "Enter Student ID to edit: ";
+        readLine(id);
+        if (!studentExistsCI(id)) {
+            termOut() << "Student not found (not case sensitive). Please try again.\n";
+            suggestStudents(id);
+        } else {
+            found = true;
+        }
+    } while (!found);
+
+    StudentView s;
+    if (!Registry::getInstance()->findStudent(id, s, arena)) return;
+    pmr::string n(arena.resource()), e(arena.resource()), a(arena.resource()), p(arena.resource());
+    // Name validation
+    do {
+        termOut() << "Edit Name (" << s.name << "): ";
+        readLine(n);
+        if (n.empty()) break;
+        if (!isLettersOnly(n)) {
+            termOut() << "Name should be letters only.\n";
+        } else {
+            s.name = n;
+            break;
+        }
+    } while (true);
+
+    termOut() << "Edit Email (" << s.email << "): ";
+    readLine(e);
+    if (!e.empty()) s.email = e;
+
+    // Age validation
+    do {
+        termOut() << "Edit Age (" << s.age << "): ";
+        readLine(a);
+        if (a.empty()) break;
+        if (!isWholeNumber(a)) {
+            termOut() << "Age should be a whole number.\n";
+        } else {
+            s.age.assign(a.data(), a.size());
+            break;
+        }
+    } while (true);
+
+    termOut() << "Edit Program (" << s.program << "): ";
+    readLine(p);
+    if (!p.empty()) s.program = p;
+
+    if (Registry::getInstance()->updateStudent(s)) {
+        Logger::getInstance()->event(A_EDIT_STUDENT, "admin", id);
+        termOut() << "Student updated.\n";
+    }
+}
+void editCourse() {
+    string code;
+    bool found = false;
+    do {
+        termOut() << "Enter Course Code to edit: ";
+        readLine(code);
+        if (!courseExistsCI(code)) {
+            termOut() << "Course not found (not case sensitive). Please try again.\n";
+            suggestCourses(code);
+        } else {
+            found = true;
+        }
+    } while (!found);
+
+    CourseRecord c;
+    Registry::getInstance()->findCourse(code, c);
+    string n, u;
+    termOut() << "Edit Name (" << c.name << "): ";
+    readLine(n);
+    if (!n.empty()) c.name = n;
+
+    // Units validation
+    do {
+        termOut() << "Edit Units (" << c.units << "): ";
+        readLine(u);
+        if (u.empty()) break;
+        if (!isWholeNumber(u)) {
+            termOut() << "Units should be a whole number.\n";
+        } else {
+            c.units = u;
+            break;
+        }
+    } while (true);
+
+    do {
+        termOut() << "Edit Capacity (" << c.capacity << ", 0 for no limit): ";
+        readLine(u);
+        if (u.empty()) break;
+        string err = checkCapacityFor(code, u);
+        if (err.empty()) {
+            c.capacity = u;
+            break;
+        }
+        termOut() << err << "\n";
+    } while (true);
+
+    // Students may have enrolled since the capacity was checked
+    UpdateResult res = Registry::getInstance()->updateCourse(c);
+    if (res == UPDATE_OK) {
+        Logger::getInstance()->event(A_EDIT_COURSE, "admin", code);
+        termOut() << "Course updated.\n";
+    } else if (res == UPDATE_BELOW_ROSTER) {
+        termOut() << BELOW_ROSTER << "\n";
+    }
+}
+void deleteStudent() {
+    string id;
+    bool found = false;
+    do {
+        termOut() << "Enter Student ID to delete: ";
+        readLine(id);
+        if (!studentExistsCI(id)) {
+            termOut() << "Student not found (not case sensitive). Please try again.\n";
+            suggestStudents(id);
+        } else {
+            found = true;
+        }
+    } while (!found);
+
+    // Also removes the student's enrollments
+    if (Registry::getInstance()->removeStudent(id)) {
+        Logger::getInstance()->event(A_DELETE_STUDENT, "admin", id);
+        termOut() << "Student deleted.\n";
+    }
+}
+void deleteCourse() {
+    string code;
+    bool found = false;
+    do {
+        termOut() << "Enter Course Code to delete: ";
+        readLine(code);
+        if (!courseExistsCI(code)) {
+            termOut() << "Course not found (not case sensitive). Please try again.\n";
+            suggestCourses(code);
+        } else {
+            found = true;
+        }
+    } while (!found);
+
+    // Also removes the course's enrollments
+    if (Registry::getInstance()->removeCourse(code)) {
+        Logger::getInstance()->event(A_DELETE_COURSE, "admin", code);
+        termOut() << "Course deleted.\n";
+    }
+}
+
+// --- Student Features ---
+void viewProfile(const string& id, RequestArena& arena) {
+    StudentView s;
+    if (Registry::getInstance()->findStudent(id, s, arena)) {
+        termOut() << "\nID: " << s.id << "\nName: " << s.name << "\nEmail: " << s.email
+             << "\nAge: " << s.age << "\nProgram: " << s.program << endl;
+    }
+}
+void enrollCourse(const string& sid, RequestArena& arena) {
+    termOut() << "Available courses:\n";
+    Registry::getInstance()->forEachCourseSeats([](const CourseRecord& c, size_t taken) {
+        termOut() << c.code << " - " << c.name << " (" << c.units << " units";
+        uint32_t limit = seatLimit(c);
+        if (limit) termOut() << ", " << (taken < limit ? limit - taken : 0) << " of " << limit << " seats left";
+        termOut() << ")\n";
+    });
+    pmr::string code(arena.resource());
+    bool valid = false;
+    do {
+        termOut() << "Enter Course Code to enroll: ";
+        readLine(code);
+        if (!courseExistsCI(code)) {
+            termOut() << "Course not found (not case sensitive). Please try again.\n";
+            suggestCourses(code);
+        } else if (isEnrolled(sid, code)) {
+            termOut() << "You are already enrolled in this course. Please choose another course.\n";
+        } else {
+            valid = true;
+        }
+    } while (!valid);
+    // Another session may have taken the last seat or changed the course list
+    EnrollResult r = Registry::getInstance()->enroll(sid, code);
+    if (r == ENROLL_FULL) {
+        termOut() << "Enrollment failed: the course is full.\n";
+        return;
+    }
+    if (r != ENROLL_OK) {
+        termOut() << "Enrollment failed: the course is no longer available or you are already enrolled.\n";
+        return;
+    }
+    Logger::getInstance()->event(A_ENROLL, sid, code);
+    termOut() << "Enrolled in course.\n";
+}
+void viewEnrolledCourses(const string& sid, RequestArena& arena) {
+    termOut() << "Enrolled courses:\n";
+    pmr::vector<CourseView> enrolled = Registry::getInstance()->coursesOf(sid, arena);
+    for (size_t i = 0; i < enrolled.size(); ++i)
+        termOut() << enrolled[i].code << " - " << enrolled[i].name << " (" << enrolled[i].units << " units)\n";
+    if (enrolled.empty()) termOut() << "None.\n";
+}
+void editProfile(const string& sid, RequestArena& arena) {
+    StudentView s;
+    if (!Registry::getInstance()->findStudent(sid, s, arena)) return;
+    pmr::string n(arena.resource()), e(arena.resource()), a(arena.resource());
+    // Name validation
+    do {
+        termOut() << "Edit Name (" << s.name << "): ";
+        readLine(n);
+        if (n.empty()) break;
+        if (!isLettersOnly(n)) {
+            termOut() << "Name should be letters only.\n";
+        } else {
+            s.name = n;
+            break;
+        }
+    } while (true);
+
+    termOut() << "Edit Email (" << s.email << "): ";
+    readLine(e);
+    if (!e.empty()) s.email = e;
+
+    // Age validation
+    do {
+        termOut() << "Edit Age (" << s.age << "): ";
+        readLine(a);
+        if (a.empty()) break;
+        if (!isWholeNumber(a)) {
+            termOut() << "Age should be a whole number.\n";
+        } else {
+            s.age.assign(a.data(), a.size());
+            break;
+        }
+    } while (true);
+
+    if (Registry::getInstance()->updateStudent(s)) {
+        Logger::getInstance()->event(A_EDIT_PROFILE, sid);
+        termOut() << "Profile updated.\n";
+    }
+}
+void dropCourse(const string& sid, RequestArena& arena) {
+    pmr::string code(arena.resource());
+    bool valid = false;
+    do {
+        termOut() << "Enter Course Code to drop: ";
+        readLine(code);
+        if (!courseExistsCI(code)) {
+            termOut() << "Course not found (not case sensitive). Please try again.\n";
+            suggestCourses(code);
+        } else if (!isEnrolled(sid, code)) {
+            termOut() << "Not enrolled in this course.\n";
+        } else {
+            valid = true;
+        }
+    } while (!valid);
+
+    if (Registry::getInstance()->drop(sid, code)) {
+        Logger::getInstance()->event(A_DROP, sid, code);
+        termOut() << "Dropped course.\n";
+    }
+}
+
+// --- Admin Option Handler ---
+void reportUnsaved(const JournalError& ex) {
+    Logger::getInstance()->log(string("Unsaved change: ") + ex.what());
+    termOut() << "Warning: the change could not be saved to disk yet (" << ex.what()
+              << "). It will be retried with the next change.\n";
+}
+bool Admin::handleOption(int opt) {
+    RequestArena arena;
+    MetricTimer timer(opt >= 1 && opt <= 12 ? ADMIN_METRICS[opt - 1] : M_COUNT);
+    try {
+        switch (opt) {
+            case 1: addStudent(); break;
+            case 2: addCourse(); break;
+            case 3: viewAllStudents(); break;
+            case 4: viewAllCourses(); break;
+            case 5: viewStudentsPerCourse(arena); break;
+            case 6: editStudent(arena); break;
+            case 7: editCourse(); break;
+            case 8: deleteStudent(); break;
+            case 9: deleteCourse(); break;
+            case 10: chooseDisplayStrategy(); break;
+            case 11:
+                Logger::getInstance()->event(A_LOGOUT, "admin");
+                return false;
+            case 12: findStudents(); break;
+            default:
+                termOut() << "Invalid option.\n";
+        }
+    } catch (const JournalError& ex) {
+        reportUnsaved(ex);
+    }
+    return true;
+}
+
+// --- Student Option Handler ---
+bool Student::handleOption(int opt) {
+    RequestArena arena;
+    MetricTimer timer(opt >= 1 && opt <= 7 ? STUDENT_METRICS[opt - 1] : M_COUNT);
+    try {
+        switch (opt) {
+            case 1: viewProfile(getId(), arena); break;
+            case 2: enrollCourse(getId(), arena); break;
+            case 3: viewEnrolledCourses(getId(), arena); break;
+            case 4: editProfile(getId(), arena); break;
+            case 5: dropCourse(getId(), arena); break;
+            case 6: chooseDisplayStrategy(); break;
+            case 7: Logger::getInstance()->event(A_LOGOUT, getId()); return false;
+            default: termOut() << "Invalid option.\n";
+        }
+    } catch (const JournalError& ex) {
+        reportUnsaved(ex);
+    }
+    return true;
+}
+
+// --- Login ---
+unique_ptr<User> login() {
+    bool loggedIn = false;
+    unique_ptr<User> user;
+    do {
+        string username, password;
+        termOut() << "Username (admin or student ID): ";
+        readLine(username);
+        termOut() << "Password: ";
+        readLine(password);
+
+        // Turned away before touching the credential store, and not counted
+        LoginThrottle* throttle = LoginThrottle::getInstance();
+        int64_t waitMs = throttle->delayFor(username, sessionSource);
+        if (waitMs > 0) {
+            termOut() << "Too many failed logins. Try again in " << (waitMs + 999) / 1000 << " s.\n";
+            Logger::getInstance()->log("Login throttled for " + trim(username) + " from " + sessionSource);
+            continue;
+        }
+
+        StudentRecord s;
+        CredentialStore::Access access;
+        {
+            MetricTimer timer(M_LOGIN);
+            access = CredentialStore::getInstance()->login(username, password, s);
+        }
+        if (access == CredentialStore::ADMIN_ACCESS) {
+            Logger::getInstance()->event(A_LOGIN, "admin");
+            user.reset(new Admin("admin", "Administrator", "admin@school.edu", ""));
+            loggedIn = true;
+        } else if (access == CredentialStore::STUDENT_ACCESS) {
+            Logger::getInstance()->event(A_LOGIN, s.id);
+            user.reset(new Student(s.id, s.name, s.email, s.password));
+            loggedIn = true;
+        }
+        if (!loggedIn) {
+            throttle->recordFailure(username, sessionSource);
+            termOut() << "Login failed: Invalid credentials. Try again.\n";
+        }
+    } while (!loggedIn);
+    return user;
+}
+void runSession() {
+    termOut() << "=== Student Management System ===\n";
+    auto user = login();
+    bool running = true;
+    while (running) {
+        user->menu();
+        termOut() << "Select option: ";
+        string optstr;
+        readLine(optstr);
+        int opt = 0;
+        bool valid = true;
+
+        int minOpt = 1, maxOpt = user->optionCount();
+
+        // Only digits, no spaces, and within allowed range
+        if (optstr.empty() || optstr.find_first_not_of("0123456789") != string::npos)
+            valid = false;
+        else {
+            opt = stoi(optstr);
+            if (opt < minOpt || opt > maxOpt) valid = false;
+        }
+
+        if (!valid) {
+            termOut() << "Invalid input. Please enter a number from " << minOpt << " to " << maxOpt << " only.\n";
+            continue;
+        }
+
+        running = user->handleOption(opt);
+    }
+}
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// --- Server mode (run with: main --serve [socket], join with: main --connect [socket]) ---
+#ifndef _WIN32
+FdStreamBuf::FdStreamBuf(int socket) : fd(socket) {
+    setg(inBuf, inBuf, inBuf);
+    setp(outBuf, outBuf + sizeof(outBuf));
+}
+FdStreamBuf::int_type FdStreamBuf::underflow() {
+    ssize_t n;
+    do {
+        n = ::recv(fd, inBuf, sizeof(inBuf), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return traits_type::eof();
+    setg(inBuf, inBuf, inBuf + n);
+    return traits_type::to_int_type(inBuf[0]);
+}
+FdStreamBuf::int_type FdStreamBuf::overflow(int_type ch) {
+    if (sync() != 0) return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+int FdStreamBuf::sync() {
+    const char* p = pbase();
+    while (p < pptr()) {
+        ssize_t n = ::send(fd, p, pptr() - p, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            setp(outBuf, outBuf + sizeof(outBuf));
+            return -1;
+        }
+        p += n;
+    }
+    setp(outBuf, outBuf + sizeof(outBuf));
+    return 0;
+}
+void serveSession(int fd) {
+    {
+        FdStreamBuf buf(fd);
+        istream in(&buf);
+        ostream out(&buf);
+        in.tie(&out);
+        sessionIn = &in;
+        sessionOut = &out;
+        sessionSource = "local";
+#ifdef SO_PEERCRED
+        ucred peer;
+        socklen_t len = sizeof(peer);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &len) == 0) sessionSource = "uid " + to_string(peer.uid);
+#endif
+        try {
+            runSession();
+        } catch (const SessionClosed&) {
+        } catch (const exception& ex) {
+            Logger::getInstance()->log(string("Session ended: ") + ex.what());
+        }
+        out.flush();
+        delete displayStrategy;
+        displayStrategy = nullptr;
+    }
+    ::close(fd);
+}
+bool socketAddress(const string& path, sockaddr_un& addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+int runServer(const string& path) {
+    sockaddr_un addr;
+    if (!socketAddress(path, addr)) {
+        cerr << "Socket path too long: " << path << endl;
+        return 1;
+    }
+    // SIGINT/SIGTERM are taken by one thread so shutdown runs outside a handler
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    Registry* reg;
+    try {
+        reg = Registry::getInstance();
+    } catch (const exception& ex) {
+        cerr << ex.what() << endl;
+        return 1;
+    }
+    Logger::getInstance();
+    CredentialStore::getInstance();
+    LoginThrottle::getInstance();
+    Metrics::getInstance()->start(METRICS_FILE, METRICS_PERIOD);
+    SourceWatcher::getInstance()->start();
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    // The process lock is held, so a socket file left here is stale
+    ::unlink(path.c_str());
+    if (listener < 0 || ::bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listener, SOMAXCONN) != 0) {
+        cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    thread([stopSignals, reg, path]() {
+        int sig;
+        sigwait(&stopSignals, &sig);
+        ::unlink(path.c_str());
+        SourceWatcher::getInstance()->shutdown();
+        reg->checkpoint();
+        Logger::getInstance()->shutdown();
+        Metrics::getInstance()->shutdown();
+        _exit(0);
+    }).detach();
+
+    cout << "Serving on " << path << " (Ctrl+C to stop)" << endl;
+    while (true) {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // Out of descriptors: back off instead of spinning
+            this_thread::sleep_for(chrono::milliseconds(10));
+            continue;
+        }
+        try {
+            thread(serveSession, fd).detach();
+        } catch (const system_error&) {
+            ::close(fd);
+        }
+    }
+}
+int runClient(const string& path) {
+    sockaddr_un addr;
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (!socketAddress(path, addr) || fd < 0 || ::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        cerr << "Cannot connect to " << path << " (is main --serve running?)" << endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    char buf[4096];
+    bool inputOpen = true;
+    while (true) {
+        pollfd fds[2] = {{fd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+        if (::poll(fds, inputOpen ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) break;
+            if (::write(STDOUT_FILENO, buf, n) != n) break;
+        }
+        if (inputOpen && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t n = ::read(STDIN_FILENO, buf, sizeof(buf));
+            if (n <= 0) {
+                // Let the server see end of input; keep printing what it sends
+                ::shutdown(fd, SHUT_WR);
+                inputOpen = false;
+            } else if (::send(fd, buf, n, MSG_NOSIGNAL) != n) {
+                break;
+            }
+        }
+    }
+    ::close(fd);
+    return 0;
+}
+#else
+int runServer(const string&) {
+    cerr << "Server mode is not available on this platform." << endl;
+    return 1;
+}
+int runClient(const string&) {
+    cerr << "Server mode is not available on this platform." << endl;
+    return 1;
+}
+#endif
+
+// --- Batch mode (run with: main --batch ops.jsonl [--group N]) ---
+bool parseFlatJson(string_view s, vector<pair<string, string> >& out, string& err) {
+    out.clear();
+    size_t i = 0;
+    auto skipSpace = [&]() {
+        while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) ++i;
+    };
+    auto readString = [&](string& v) -> bool {
+        if (i >= s.size() || s[i] != '"') return false;
+        ++i;
+        v.clear();
+        while (i < s.size() && s[i] != '"') {
+            char c = s[i++];
+            if (c != '\\') {
+                v += c;
+                continue;
+            }
+            if (i >= s.size()) return false;
+            char e = s[i++];
+            switch (e) {
+                case 'n': v += '\n'; break;
+                case 't': v += '\t'; break;
+                case 'r': v += '\r'; break;
+                case 'b': v += '\b'; break;
+                case 'f': v += '\f'; break;
+                case 'u': {
+                    if (s.size() - i < 4) return false;
+                    unsigned code = (unsigned)strtoul(string(s.substr(i, 4)).c_str(), nullptr, 16);
+                    v += code < 0x80 ? (char)code : '?';
+                    i += 4;
+                    break;
+                }
+                default: v += e;
+            }
+        }
+        if (i >= s.size()) return false;
+        ++i;
+        return true;
+    };
+    skipSpace();
+    if (i >= s.size() || s[i] != '{') {
+        err = "expected a JSON object";
+        return false;
+    }
+    ++i;
+    skipSpace();
+    if (i < s.size() && s[i] == '}') return true;
+    while (true) {
+        string key, value;
+        skipSpace();
+        if (!readString(key)) {
+            err = "expected a quoted key";
+            return false;
+        }
+        skipSpace();
+        if (i >= s.size() || s[i] != ':') {
+            err = "expected ':' after \"" + key + "\"";
+            return false;
+        }
+        ++i;
+        skipSpace();
+        if (i < s.size() && s[i] == '"') {
+            if (!readString(value)) {
+                err = "unterminated string for \"" + key + "\"";
+                return false;
+            }
+        } else {
+            size_t start = i;
+            while (i < s.size() && s[i] != ',' && s[i] != '}' && s[i] != ' ') ++i;
+            value = string(s.substr(start, i - start));
+            if (value.empty() || value == "null") {
+                err = "missing value for \"" + key + "\"";
+                return false;
+            }
+        }
+        out.push_back(make_pair(key, value));
+        skipSpace();
+        if (i < s.size() && s[i] == ',') {
+            ++i;
+            continue;
+        }
+        if (i < s.size() && s[i] == '}') return true;
+        err = "expected ',' or '}'";
+        return false;
+    }
+}
+bool BatchRecord::has(const string& key) const {
+    for (size_t i = 0; i < kv.size(); ++i)
+        if (kv[i].first == key) return true;
+    return false;
+}
+string BatchRecord::get(const string& key) const {
+    for (size_t i = 0; i < kv.size(); ++i)
+        if (kv[i].first == key) return trim(kv[i].second);
+    return "";
+}
+string runBatchOp(const BatchRecord& r) {
+    Registry* reg = Registry::getInstance();
+    string op = r.get("op"), err;
+    if (op == "add_student") {
+        StudentRecord s = {r.get("id"), r.get("name"), r.get("email"), r.get("age"), r.get("program"), r.get("password")};
+        if (!(err = checkNewStudentId(s.id)).empty() || !(err = checkName(s.name)).empty() ||
+            !(err = checkAge(s.age)).empty() || !(err = checkFreeText("Email", s.email)).empty() ||
+            !(err = checkFreeText("Program", s.program)).empty() || !(err = checkFreeText("Password", s.password)).empty())
+            return err;
+        s.password = hashPassword(s.password);
+        reg->addStudent(s);
+        Logger::getInstance()->event(A_ADD_STUDENT, "admin", s.id);
+    } else if (op == "edit_student") {
+        StudentRecord s;
+        if (!reg->findStudent(r.get("id"), s)) return "Student not found.";
+        if (r.has("name") && !(err = checkName(s.name = r.get("name"))).empty()) return err;
+        if (r.has("age") && !(err = checkAge(s.age = r.get("age"))).empty()) return err;
+        if (r.has("email") && !(err = checkFreeText("Email", s.email = r.get("email"))).empty()) return err;
+        if (r.has("program") && !(err = checkFreeText("Program", s.program = r.get("program"))).empty()) return err;
+        reg->updateStudent(s);
+        Logger::getInstance()->event(A_EDIT_STUDENT, "admin", s.id);
+    } else if (op == "delete_student") {
+        if (!reg->removeStudent(r.get("id"))) return "Student not found.";
+        Logger::getInstance()->event(A_DELETE_STUDENT, "admin", r.get("id"));
+    } else if (op == "add_course") {
+        CourseRecord c = {r.get("code"), r.get("name"), r.get("units"), r.has("capacity") ? r.get("capacity") : "0"};
+        if (!(err = checkNewCourseCode(c.code)).empty() || !(err = checkFreeText("Course name", c.name)).empty() ||
+            !(err = checkUnits(c.units)).empty() || !(err = checkCapacity(c.capacity)).empty())
+            return err;
+        reg->addCourse(c);
+        Logger::getInstance()->event(A_ADD_COURSE, "admin", c.code);
+    } else if (op == "edit_course") {
+        CourseRecord c;
+        if (!reg->findCourse(r.get("code"), c)) return "Course not found.";
+        if (r.has("name") && !(err = checkFreeText("Course name", c.name = r.get("name"))).empty()) return err;
+        if (r.has("units") && !(err = checkUnits(c.units = r.get("units"))).empty()) return err;
+        if (r.has("capacity") && !(err = checkCapacityFor(c.code, c.capacity = r.get("capacity"))).empty()) return err;
+        if (reg->updateCourse(c) == UPDATE_BELOW_ROSTER) return BELOW_ROSTER;
+        Logger::getInstance()->event(A_EDIT_COURSE, "admin", c.code);
+    } else if (op == "delete_course") {
+        if (!reg->removeCourse(r.get("code"))) return "Course not found.";
+        Logger::getInstance()->event(A_DELETE_COURSE, "admin", r.get("code"));
+    } else if (op == "enroll" || op == "drop") {
+        StudentRecord s;
+        CourseRecord c;
+        if (!reg->findStudent(r.get("student"), s)) return "Student not found.";
+        if (!reg->findCourse(r.get("course"), c)) return "Course not found.";
+        if (op == "enroll") {
+            EnrollResult res = reg->enroll(s.id, c.code);
+            if (res == ENROLL_FULL) return "Course is full.";
+            if (res != ENROLL_OK) return "Already enrolled in this course.";
+            Logger::getInstance()->event(A_ENROLL, s.id, c.code);
+        } else {
+            if (!reg->drop(s.id, c.code)) return "Not enrolled in this course.";
+            Logger::getInstance()->event(A_DROP, s.id, c.code);
+        }
+    } else {
+        return op.empty() ? "Missing \"op\"." : "Unknown op \"" + op + "\".";
+    }
+    return "";
+}
+int runBatch(const string& path, size_t group) {
+    ifstream fin(path.c_str());
+    if (!fin) {
+        cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    Registry* reg = Registry::getInstance();
+    vector<pair<string, string> > kv;
+    string line, err;
+    size_t lineNo = 0, applied = 0, rejected = 0, inGroup = 0;
+    auto start = chrono::steady_clock::now();
+    reg->beginGroup();
+    while (getline(fin, line)) {
+        ++lineNo;
+        if (trim(line).empty()) continue;
+        if (!parseFlatJson(line, kv, err)) {
+            cerr << path << ":" << lineNo << ": " << err << "\n";
+            ++rejected;
+            continue;
+        }
+        err = runBatchOp(BatchRecord(kv));
+        if (!err.empty()) {
+            cerr << path << ":" << lineNo << ": " << err << "\n";
+            ++rejected;
+            continue;
+        }
+        ++applied;
+        if (++inGroup == group) {
+            reg->commitGroup();
+            reg->beginGroup();
+            inGroup = 0;
+        }
+    }
+    reg->commitGroup();
+    reg->checkpoint();
+    double secs = secondsSince(start);
+    cout << applied << " applied, " << rejected << " rejected, " << lineNo << " lines in " << fixed
+         << setprecision(3) << secs << " s (" << setprecision(0) << (secs > 0 ? applied / secs : 0) << " ops/s)\n";
+    return rejected ? 2 : 0;
+}
+
+// --- Bulk import (run with: main --import students|courses|enrollments file.csv [--threads N] [--header]) ---
+string checkImportRow(const string& kind, const string_view* f, size_t found) {
+    string err;
+    if (kind == "students") {
+        if (found != 6) return "expected 6 fields, found " + to_string(found);
+        string id(f[0]);
+        if (id.size() > MAX_ID_LEN) return "Student ID must be at most " + to_string(MAX_ID_LEN) + " characters.";
+        if (id.find(' ') != string::npos) return "Student ID must not contain spaces.";
+        if (!isAlphanumeric(id)) return "Student ID must be strictly alphanumeric.";
+        if (CredentialStore::isReservedId(id)) return "Student ID \"admin\" is reserved.";
+        if (!(err = checkName(string(f[1]))).empty()) return err;
+        if (!(err = checkAge(string(f[3]))).empty()) return err;
+    } else if (kind == "courses") {
+        if (found != 3 && found != 4) return "expected 3 or 4 fields, found " + to_string(found);
+        string code(f[0]);
+        if (code.size() > MAX_ID_LEN) return "Course code must be at most " + to_string(MAX_ID_LEN) + " characters.";
+        if (code.find(' ') != string::npos) return "Course code must not contain spaces.";
+        if (!isAlphanumeric(code)) return "Course code must be strictly alphanumeric.";
+        if (!(err = checkUnits(string(f[2]))).empty()) return err;
+        if (found == 4 && !(err = checkCapacity(string(f[3]))).empty()) return err;
+    } else {
+        if (found != 2) return "expected 2 fields, found " + to_string(found);
+        if (f[0].empty() || f[1].empty()) return "Student ID and course code are required.";
+    }
+    return "";
+}
+void checkImportRows(const string& kind, const string_view* f, size_t width, const size_t* found, size_t n, string* errors,
+                     const char* readLimit) {
+    vector<char> ok(n, 1), column(n);
+    auto require = [&](size_t at, CharClass cls) {
+        classifyColumn(f + at, width, n, cls, column.data(), readLimit);
+        for (size_t i = 0; i < n; ++i) ok[i] &= column[i];
+    };
+    if (kind == "students") {
+        require(0, CLASS_ALNUM);
+        require(1, CLASS_LETTERS);
+        require(3, CLASS_DIGITS);
+        for (size_t i = 0; i < n; ++i)
+            if (found[i] != 6 || equalsIgnoreCase(f[i * width], "admin")) ok[i] = 0;
+    } else if (kind == "courses") {
+        require(0, CLASS_ALNUM);
+        require(2, CLASS_DIGITS);
+        classifyColumn(f + 3, width, n, CLASS_DIGITS, column.data(), readLimit);
+        for (size_t i = 0; i < n; ++i)
+            if (!(found[i] == 3 || (found[i] == 4 && column[i] && f[i * width + 3].size() <= 9))) ok[i] = 0;
+    } else {
+        for (size_t i = 0; i < n; ++i) ok[i] = 0;
+    }
+    for (size_t i = 0; i < n; ++i)
+        if (f[i * width].size() > MAX_ID_LEN) ok[i] = 0;
+    for (size_t i = 0; i < n; ++i) errors[i] = ok[i] ? string() : checkImportRow(kind, f + i * width, found[i]);
+}
+int runImport(const string& kind, const string& path, size_t threads, bool header) {
+    size_t width = kind == "students" ? 6 : kind == "courses" ? 4 : kind == "enrollments" ? 2 : 0;
+    if (!width) {
+        cerr << "Import kind must be students, courses or enrollments\n";
+        return 1;
+    }
+    if (!filesystem::exists(path)) {
+        cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    auto start = chrono::steady_clock::now();
+    string data = readWholeFile(path.c_str());
+
+    // Line table (views into the one buffer), skipping blank lines
+    vector<string_view> lines;
+    vector<size_t> lineNos;
+    {
+        const char* p = data.data();
+        const char* end = p + data.size();
+        for (size_t n = 1; p < end; ++n) {
+            const char* nl = findByte(p, end, '\n');
+            string_view line(p, (size_t)(nl - p));
+            p = nl + 1;
+            if (trimView(line).empty()) continue;
+            lines.push_back(line);
+            lineNos.push_back(n);
+        }
+    }
+    size_t headerLine = 0;
+    if (!lines.empty()) {
+        string_view f[8];
+        splitLine(lines[0], f, 1);
+        if (header || equalsIgnoreCase(f[0], "id") || equalsIgnoreCase(f[0], "code") || equalsIgnoreCase(f[0], "student") ||
+            equalsIgnoreCase(f[0], "student_id")) {
+            headerLine = lineNos[0];
+            lines.erase(lines.begin());
+            lineNos.erase(lineNos.begin());
+        }
+    }
+    size_t total = lines.size();
+    cerr << "Validating " << total << " " << kind << " rows on " << threads << " thread(s)...\n";
+
+    // Pass 1, parallel: field checks and password hashing, a block of rows at a time
+    const size_t BLOCK = 4096;
+    const char* readLimit = data.data() + data.size();
+    vector<string> rowErrors(total), hashed(kind == "students" ? total : 0);
+    atomic<size_t> checked(0);
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.push_back(thread([&, t]() {
+            vector<string_view> f(BLOCK * width);
+            vector<size_t> found(BLOCK);
+            size_t from = total * t / threads, to = total * (t + 1) / threads;
+            for (size_t first = from; first < to; first += BLOCK) {
+                size_t n = min(BLOCK, to - first);
+                for (size_t r = 0; r < n; ++r) {
+                    string_view line = lines[first + r];
+                    found[r] = 1;
+                    for (const char* c = line.data(); (c = findByte(c, line.data() + line.size(), ',')) != line.data() + line.size(); ++c)
+                        ++found[r];
+                    splitLine(line, &f[r * width], width);
+                }
+                checkImportRows(kind, f.data(), width, found.data(), n, &rowErrors[first], readLimit);
+                if (hashed.empty()) {
+                    checked.fetch_add(n, memory_order_relaxed);
+                    continue;
+                }
+                // Hashing dominates, so progress is counted a row at a time here
+                for (size_t r = 0; r < n; ++r) {
+                    string password(f[r * width + 5]);
+                    if (rowErrors[first + r].empty())
+                        hashed[first + r] = isHashedPassword(password) ? password : hashPassword(password);
+                    checked.fetch_add(1, memory_order_relaxed);
+                }
+            }
+        }));
+    }
+    // Progress once validation has taken a while, whatever the row count
+    size_t shown = 0;
+    while (checked.load(memory_order_relaxed) < total) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        size_t done = checked.load(memory_order_relaxed);
+        if (secondsSince(start) >= 1 && done * 10 / total > shown) {
+            shown = done * 10 / total;
+            cerr << "  " << shown * 10 << "% validated\n";
+        }
+    }
+    for (size_t t = 0; t < threads; ++t) workers[t].join();
+
+    // Pass 2, in file order: duplicates and references, then apply
+    Registry* reg = Registry::getInstance();
+    vector<ImportReject> rejects;
+    FoldedKeyIndex seen;
+    vector<string_view> seenKeys;
+    auto keyAt = [&seenKeys](uint32_t slot) -> string_view { return seenKeys[slot]; };
+    size_t applied = 0;
+    string_view f[8];
+    reg->beginGroup();
+    for (size_t i = 0; i < total; ++i) {
+        if (!rowErrors[i].empty()) {
+            rejects.push_back({lineNos[i], rowErrors[i]});
+            continue;
+        }
+        splitLine(lines[i], f, width);
+        if (kind == "enrollments") {
+            StudentRecord s;
+            CourseRecord c;
+            if (!reg->findStudent(string(f[0]), s)) rejects.push_back({lineNos[i], "Student not found."});
+            else if (!reg->findCourse(string(f[1]), c)) rejects.push_back({lineNos[i], "Course not found."});
+            else {
+                EnrollResult res = reg->enroll(s.id, c.code);
+                if (res == ENROLL_FULL) rejects.push_back({lineNos[i], "Course is full."});
+                else if (res != ENROLL_OK) rejects.push_back({lineNos[i], "Already enrolled in this course."});
+                else ++applied;
+            }
+            continue;
+        }
+        if (seen.find(f[0], keyAt) >= 0) {
+            rejects.push_back({lineNos[i], "Duplicate of an earlier row in this file."});
+            continue;
+        }
+        seenKeys.push_back(f[0]);
+        seen.insert(f[0], (uint32_t)(seenKeys.size() - 1));
+        if (kind == "students") {
+            if (reg->hasStudent(string(f[0]))) {
+                rejects.push_back({lineNos[i], "Student ID already exists."});
+                continue;
+            }
+            reg->addStudent({string(f[0]), string(f[1]), string(f[2]), string(f[3]), string(f[4]), hashed[i]});
+        } else {
+            if (reg->hasCourse(string(f[0]))) {
+                rejects.push_back({lineNos[i], "Course code already exists (case-insensitive)."});
+                continue;
+            }
+            reg->addCourse({string(f[0]), string(f[1]), string(f[2]), f[3].empty() ? "0" : string(f[3])});
+        }
+        ++applied;
+    }
+    reg->commitGroup();
+    reg->checkpoint();
+    Logger::getInstance()->log("Admin imported " + to_string(applied) + " " + kind + " from " + path);
+
+    if (!rejects.empty()) {
+        string report = path + ".rejects.txt";
+        ofstream rout(report.c_str());
+        for (size_t i = 0; i < rejects.size(); ++i) {
+            rout << "line " << rejects[i].line << ": " << rejects[i].reason << "\n";
+            if (i < 10) cerr << path << ":" << rejects[i].line << ": " << rejects[i].reason << "\n";
+        }
+        if (rejects.size() > 10) cerr << "... " << rejects.size() - 10 << " more\n";
+        cerr << "Rejected rows written to " << report << "\n";
+    }
+    double secs = secondsSince(start);
+    cout << applied << " imported, " << rejects.size() << " rejected in " << fixed << setprecision(3) << secs
+         << " s (" << setprecision(0) << (secs > 0 ? total / secs : 0) << " rows/s)";
+    if (headerLine) cout << ", skipped header row " << headerLine;
+    cout << "\n";
+    return rejects.empty() ? 0 : 2;
+}
+
+// --- Export (run with: main --export students|courses|enrollments [--format json|ndjson|csv] [--out file]) ---
+int runExport(const string& kind, const string& formatName, const string& outPath) {
+    OutputFormat format;
+    if (formatName == "json") format = FORMAT_JSON;
+    else if (formatName == "ndjson") format = FORMAT_NDJSON;
+    else if (formatName == "csv") format = FORMAT_CSV;
+    else {
+        cerr << "Export format must be json, ndjson or csv\n";
+        return 1;
+    }
+    if (kind != "students" && kind != "courses" && kind != "enrollments") {
+        cerr << "Export kind must be students, courses or enrollments\n";
+        return 1;
+    }
+    ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath.c_str(), ios::binary);
+        if (!file) {
+            cerr << "Cannot write " << outPath << "\n";
+            return 1;
+        }
+    }
+    ostream& sink = outPath.empty() ? cout : file;
+    const size_t CHUNK = 1 << 20;
+    string out;
+    out.reserve(CHUNK + 4096);
+    size_t rows = 0, bytes = 0;
+    auto drain = [&](bool force) {
+        if (out.size() < CHUNK && !force) return;
+        sink.write(out.data(), (streamsize)out.size());
+        bytes += out.size();
+        out.clear();
+    };
+
+    Registry* reg = Registry::getReadOnlyInstance();
+    auto start = chrono::steady_clock::now();
+    if (kind == "students") {
+        RecordEncoder enc(format, STUDENT_FIELDS, STUDENT_NUMERIC, 5);
+        enc.begin(out);
+        reg->forEachStudent([&](const StudentView& s) {
+            encodeStudent(enc, out, s);
+            ++rows;
+            drain(false);
+        });
+        enc.end(out);
+    } else if (kind == "courses") {
+        RecordEncoder enc(format, COURSE_FIELDS, COURSE_NUMERIC, 5);
+        enc.begin(out);
+        reg->forEachCourseSeats([&](const CourseRecord& c, size_t taken) {
+            encodeCourse(enc, out, c, taken);
+            ++rows;
+            drain(false);
+        });
+        enc.end(out);
+    } else {
+        RecordEncoder enc(format, ENROLLMENT_FIELDS, ENROLLMENT_NUMERIC, 2);
+        enc.begin(out);
+        reg->forEachEnrollment([&](const StudentView& s, const CourseRecord& c) {
+            string_view v[2] = {s.id, c.code};
+            enc.row(out, v);
+            ++rows;
+            drain(false);
+        });
+        enc.end(out);
+    }
+    drain(true);
+    sink.flush();
+    if (!sink) {
+        cerr << "Write failed\n";
+        return 1;
+    }
+    double secs = secondsSince(start);
+    cerr << rows << " " << kind << " exported, " << fixed << setprecision(1) << bytes / 1048576.0 << " MiB in "
+         << setprecision(3) << secs << " s\n";
+    return 0;
+}
+
+// --- Audit query (run with: main --audit-query [filters]) ---
+bool parseWhen(const string& s, bool endOfRange, int64_t& out) {
+    if (isWholeNumber(s)) {
+        out = strtoll(s.c_str(), nullptr, 10);
+        return true;
+    }
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    int hour = -1, minute = 0;
+    if (sscanf(s.c_str(), "%d-%d-%d %d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday, &hour, &minute) < 3) return false;
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    t.tm_isdst = -1;
+    if (hour >= 0) {
+        t.tm_hour = hour;
+        t.tm_min = minute;
+    }
+    time_t when = mktime(&t);
+    if (when == (time_t)-1) return false;
+    out = (int64_t)when + (endOfRange ? (hour >= 0 ? 59 : 86399) : 0);
+    return true;
+}
+int runAuditQuery(int argc, char* argv[]) {
+    string dir = "audit", actor, target, subject;
+    int action = -1;
+    int64_t since = INT64_MIN, until = INT64_MAX;
+    for (int i = 2; i < argc; ++i) {
+        string opt = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << opt << "\n";
+            return 1;
+        }
+        string val = argv[++i];
+        if (opt == "--dir") dir = val;
+        else if (opt == "--actor") actor = val;
+        else if (opt == "--target") target = val;
+        else if (opt == "--subject") subject = val;
+        else if (opt == "--action") {
+            for (int a = 0; a < A_ACTION_COUNT; ++a)
+                if (val == AUDIT_ACTION_NAMES[a]) action = a;
+            if (action < 0) {
+                cerr << "Unknown action: " << val << "\n";
+                return 1;
+            }
+        } else if (opt == "--since" || opt == "--until") {
+            if (!parseWhen(val, opt == "--until", opt == "--since" ? since : until)) {
+                cerr << "Bad time for " << opt << ": " << val << "\n";
+                return 1;
+            }
+        } else {
+            cerr << "Unknown option: " << opt << "\n"
+                 << "Usage: main --audit-query [--actor ID] [--target ID] [--subject ID] [--action NAME]\n"
+                 << "                          [--since WHEN] [--until WHEN] [--dir DIR]\n";
+            return 1;
+        }
+    }
+
+    // Only IDs from data files older than MAX_ID_LEN can be longer; records
+    // hold their first AUDIT_ID_LEN characters, so they are looked up that way
+    for (string* id : {&actor, &target, &subject})
+        if (id->size() > AUDIT_ID_LEN) {
+            cerr << "Note: " << *id << " is matched by its first " << AUDIT_ID_LEN << " characters\n";
+            id->resize(AUDIT_ID_LEN);
+        }
+
+    string indexData = readWholeFile((dir + "/index.dat").c_str());
+    size_t indexed = indexData.size() / sizeof(AuditIndexEntry);
+    size_t segments = 0, opened = 0, matches = 0;
+    for (uint32_t seg = 1; filesystem::exists(auditSegmentPath(dir, seg)); ++seg) {
+        ++segments;
+        string path = auditSegmentPath(dir, seg);
+        uint64_t events = filesystem::file_size(path) / sizeof(AuditEvent);
+        // An entry that disagrees with the file (crash before the index was
+        // written) cannot be trusted, so that segment is always scanned
+        if (seg <= indexed) {
+            AuditIndexEntry e;
+            memcpy(&e, indexData.data() + (seg - 1) * sizeof(AuditIndexEntry), sizeof(e));
+            if (e.segment == seg && e.count == events) {
+                if (e.count == 0 || e.maxTime < since || e.minTime > until) continue;
+                if (!actor.empty() && !bloomMayContain(e.bloom, actor)) continue;
+                if (!target.empty() && !bloomMayContain(e.bloom, target)) continue;
+                if (!subject.empty() && !bloomMayContain(e.bloom, subject)) continue;
+            }
+        }
+        ++opened;
+        string data = readWholeFile(path.c_str());
+        for (size_t i = 0; i + sizeof(AuditEvent) <= data.size(); i += sizeof(AuditEvent)) {
+            AuditEvent e;
+            memcpy(&e, data.data() + i, sizeof(e));
+            if (e.when < since || e.when > until) continue;
+            if (action >= 0 && e.action != action) continue;
+            string a = auditField(e.actor), t = auditField(e.target);
+            if (!actor.empty() && !equalsIgnoreCase(a, actor)) continue;
+            if (!target.empty() && !equalsIgnoreCase(t, target)) continue;
+            if (!subject.empty() && !equalsIgnoreCase(a, subject) && !equalsIgnoreCase(t, subject)) continue;
+            time_t when = (time_t)e.when;
+            string stamp = ctime(&when);
+            if (!stamp.empty() && stamp.back() == '\n') stamp.pop_back();
+            cout << "[" << stamp << "] " << describeEvent(e.action, a, t) << "\n";
+            ++matches;
+        }
+    }
+    cout << matches << " event(s); read " << opened << " of " << segments << " segment(s)\n";
+    return 0;
+}
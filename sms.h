@@ -0,0 +1,1983 @@
+// Student Management System: declarations shared by the sms program and its
+// benchmark program (sms_bench). The definitions live in sms.cpp.
+#ifndef SMS_H
+#define SMS_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <ctime>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+#include <random>
+#include <functional>
+#include <memory_resource>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <csignal>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#endif
+#include <fcntl.h>
+#include <sys/stat.h>
+// AVX2 kernels are built with GCC/Clang on x86 whatever the -m flags, and
+// only run on CPUs that report AVX2
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_RUNTIME_AVX2 1
+#endif
+#if defined(__AVX2__) || defined(HAVE_RUNTIME_AVX2)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+
+// Utility: trim whitespace
+string trim(const string& s);
+
+// Utility: fold ASCII letters to lower case (used for case-insensitive keys)
+string foldCase(string_view s);
+// --- Text kernels: character classes and case-blind compares ---
+// Scalar forms plus SSE2/AVX2 ones; the widest the CPU supports is picked at startup.
+enum CharClass { CLASS_ALNUM, CLASS_LETTERS, CLASS_DIGITS }; // LETTERS allows spaces
+
+bool inClassScalar(const char* p, size_t n, CharClass cls);
+bool equalFoldedScalar(const char* a, const char* b, size_t n);
+// Column form: ok[i] says whether value i (every stride-th view) is non-empty
+// and wholly in the class; bytes up to readLimit may be over-read and masked.
+void classifyScalar(const string_view* v, size_t stride, size_t n, CharClass cls, char* ok, const char*);
+
+#if defined(__SSE2__) || defined(_M_X64)
+// Lanes of x that are in [lo, hi]; bytes past 0x7f compare negative and fall out
+inline __m128i inRange16(__m128i x, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8((char)(lo - 1))), _mm_cmplt_epi8(x, _mm_set1_epi8((char)(hi + 1))));
+}
+// Setting bit 5 maps exactly the upper-case letters onto the lower-case ones
+inline unsigned classMask16(__m128i x, CharClass cls) {
+    __m128i digit = inRange16(x, '0', '9');
+    if (cls == CLASS_DIGITS) return (unsigned)_mm_movemask_epi8(digit);
+    __m128i letter = inRange16(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i other = cls == CLASS_ALNUM ? digit : _mm_cmpeq_epi8(x, _mm_set1_epi8(' '));
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(letter, other));
+}
+inline __m128i fold16(__m128i x) {
+    return _mm_add_epi8(x, _mm_and_si128(inRange16(x, 'A', 'Z'), _mm_set1_epi8(0x20)));
+}
+// Inputs shorter than a vector go to the scalar loop; the tail of a longer
+// one is an overlapping load ending at its last byte
+bool inClassSse2(const char* p, size_t n, CharClass cls);
+bool equalFoldedSse2(const char* a, const char* b, size_t n);
+void classifySse2(const string_view* v, size_t stride, size_t n, CharClass cls, char* ok, const char* readLimit);
+#endif
+
+#ifdef HAVE_RUNTIME_AVX2
+#define AVX2_KERNEL __attribute__((target("avx2")))
+AVX2_KERNEL inline __m256i inRange32(__m256i x, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8((char)(lo - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(hi + 1)), x));
+}
+AVX2_KERNEL inline unsigned classMask32(__m256i x, CharClass cls) {
+    __m256i digit = inRange32(x, '0', '9');
+    if (cls == CLASS_DIGITS) return (unsigned)_mm256_movemask_epi8(digit);
+    __m256i letter = inRange32(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+    __m256i other = cls == CLASS_ALNUM ? digit : _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' '));
+    return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(letter, other));
+}
+AVX2_KERNEL inline __m256i fold32(__m256i x) {
+    return _mm256_add_epi8(x, _mm256_and_si256(inRange32(x, 'A', 'Z'), _mm256_set1_epi8(0x20)));
+}
+AVX2_KERNEL bool inClassAvx2(const char* p, size_t n, CharClass cls);
+AVX2_KERNEL bool equalFoldedAvx2(const char* a, const char* b, size_t n);
+AVX2_KERNEL void classifyAvx2(const string_view* v, size_t stride, size_t n, CharClass cls, char* ok, const char* readLimit);
+#endif
+
+struct TextKernels {
+    const char* name;
+    bool (*inClass)(const char*, size_t, CharClass);
+    bool (*equalFolded)(const char*, const char*, size_t);
+    void (*classify)(const string_view*, size_t, size_t, CharClass, char*, const char*);
+};
+// Every set this build and CPU can run, narrowest first
+vector<TextKernels> availableTextKernels();
+extern const TextKernels textKernels;
+
+bool equalsIgnoreCase(string_view a, string_view b);
+// Values in [first, first + n * stride) by stride; see classifyScalar
+void classifyColumn(const string_view* first, size_t stride, size_t n, CharClass cls, char* ok, const char* readLimit = nullptr);
+
+// --- Open-addressing hash index on case-folded keys ---
+// FNV-1a over the folded bytes, so "ABC123" and "abc123" hash the same
+uint32_t hashFolded(string_view s);
+
+// Maps a key to a record slot. Keys are not copied: lookups compare against
+// the record itself through a keyAt(slot) accessor. Linear probing with
+// backward-shift deletion, so there are no tombstones to clean up.
+class FoldedKeyIndex {
+public:
+    struct Bucket {
+        uint32_t hash;
+        uint32_t slot;
+    };
+    static const uint32_t EMPTY = 0xffffffffu;
+private:
+    vector<Bucket> table;
+    size_t count;
+
+    size_t mask() const { return table.size() - 1; }
+    void place(const Bucket& b);
+    void rehash(size_t capacity);
+public:
+    FoldedKeyIndex() : table(16, Bucket{0, EMPTY}), count(0) {}
+    size_t size() const { return count; }
+    void clear();
+    void reserve(size_t n);
+    // Raw bucket access, for saving the table in a snapshot and adopting it back
+    const vector<Bucket>& buckets() const { return table; }
+    // Rejects a table that names a slot past rows or whose key count is off;
+    // the load limit then leaves an EMPTY bucket to end every probe
+    bool adopt(const Bucket* b, size_t capacity, size_t n, size_t rows);
+    template <class KeyAt>
+    long find(string_view key, KeyAt keyAt) const {
+        uint32_t h = hashFolded(key);
+        for (size_t i = h & mask();; i = (i + 1) & mask()) {
+            const Bucket& b = table[i];
+            if (b.slot == EMPTY) return -1;
+            if (b.hash == h && equalsIgnoreCase(keyAt(b.slot), key)) return (long)b.slot;
+        }
+    }
+    void insert(string_view key, uint32_t slot);
+    bool erase(string_view key, uint32_t slot);
+};
+
+// --- Text index: typo-tolerant prefix search over short texts ---
+// Each folded word keeps the sorted slots containing it. Query words match
+// exactly, by prefix (the last one) or within a few typos via trigrams.
+class TextIndex {
+public:
+    struct Hit {
+        uint32_t slot;
+        int typos;
+    };
+private:
+    vector<string> words;
+    unordered_map<string, uint32_t> wordIds;
+    vector<vector<uint32_t> > wordSlots;
+    vector<uint32_t> sortedWords;
+    unordered_map<uint32_t, vector<uint32_t> > gramWords;
+    vector<vector<uint32_t> > slotWords;
+    static const size_t MAX_PREFIX_WORDS = 1024;
+    static const size_t MAX_FUZZY_LENGTH = 32;
+    static const size_t PROBED_LISTS = 8;
+
+    static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+    static bool wordChar(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || isDigit(c); }
+    static void wordsOf(string_view text, vector<string>& out);
+    // Grams of "  word " (without the closing one for a prefix), sorted and distinct
+    static void gramsOf(const string& word, bool prefix, vector<uint32_t>& out);
+    // Typos allowed in a query word; a mistyped number is just another number
+    static int typoBudget(const string& word);
+    // Edit distance from a to b, or to b's closest prefix, with a swap of two
+    // neighbours counting as one edit; anything past max comes back as max + 1
+    static int distance(string_view a, string_view b, int max, bool prefix);
+    // First position at or after from whose slot is not below slot, galloping
+    // ahead since probes only ever move forward
+    static size_t seek(const vector<uint32_t>& list, size_t from, uint32_t slot);
+    uint32_t wordId(const string& word, bool keepSorted);
+    void add(uint32_t slot, string_view text, bool keepSorted);
+    // Vocabulary words matching a query word, with their typo counts
+    void matchWord(const string& q, bool prefix, unordered_map<uint32_t, int>& out) const;
+public:
+    void clear();
+    void insert(uint32_t slot, string_view text) { add(slot, text, true); }
+    // Rebuild from textOf(slot, text), which returns false for unused slots
+    template <class Fn>
+    void build(size_t slots, Fn textOf) {
+        clear();
+        string text;
+        for (size_t i = 0; i < slots; ++i)
+            if (textOf(i, text)) add((uint32_t)i, text, false);
+        sort(sortedWords.begin(), sortedWords.end(), [this](uint32_t a, uint32_t b) { return words[a] < words[b]; });
+    }
+    // Words stay in the vocabulary with an empty slot list
+    void erase(uint32_t slot);
+    // Up to k matches, fewest typos first. The last query word is a prefix
+    // unless the query ends in a space.
+    vector<Hit> search(string_view query, size_t k) const;
+    size_t wordCount() const { return words.size(); }
+private:
+    typedef pair<const vector<uint32_t>*, int> Posting;
+    // One pass over the records whose words all match with at most typos
+    // typos each; postings[j] are the slot lists query word j accepts
+    struct Tier {
+        const vector<unordered_map<uint32_t, int> >& matched;
+        int typos;
+        vector<vector<Posting> > postings;
+        vector<size_t> sizes, order;
+        size_t driver;
+        // Probe position in each posting
+        vector<vector<size_t> > at;
+        Tier(const vector<unordered_map<uint32_t, int> >& m, int tier) : matched(m), typos(tier), driver(0) {}
+    };
+    static bool widens(const vector<unordered_map<uint32_t, int> >& matched, int tier);
+    // Candidate generation: the query word with the fewest slots drives the
+    // tier, and the others are checked rarest first, as likeliest to fail
+    void candidates(Tier& t) const;
+    // Scoring: a driver slot's typos if every query word matches one of its
+    // words, else -1 with skipTo the next slot worth trying (UINT32_MAX: none)
+    int score(Tier& t, uint32_t slot, int driverTypos, uint32_t& skipTo) const;
+    // Merges the driver's lists in slot order, scoring each slot once and
+    // skipping ahead on a miss, until hits holds k
+    void collect(Tier& t, size_t k, vector<Hit>& hits) const;
+
+};
+
+// --- CSV tokenizer: splits text into string_view fields without copying ---
+inline unsigned lowestBit(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return (unsigned)i;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+// First occurrence of c in [p, end), or end; 32 or 16 bytes per step where available
+const char* findByte(const char* p, const char* end, char c);
+
+string_view trimView(string_view s);
+
+// Splits one line into up to n trimmed fields; text after the n-th comma is
+// ignored and missing fields are left empty. Returns the number found.
+size_t splitLine(string_view line, string_view* fields, size_t n);
+
+// Calls row(fields) for every non-blank line of a text buffer
+template <class Row>
+void forEachCsvLine(string_view text, size_t n, Row row) {
+    string_view fields[8];
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end) {
+        const char* nl = findByte(p, end, '\n');
+        string_view line(p, (size_t)(nl - p));
+        p = nl + 1;
+        if (trimView(line).empty()) continue;
+        splitLine(line, fields, n);
+        row(fields);
+    }
+}
+
+string readWholeFile(const char* path);
+// Up to n bytes of a file starting at offset from; fewer past its end
+string readFileRange(const char* path, uint64_t from, uint64_t n);
+
+// --- Audit log: fixed-layout binary events in rotated, indexed segments ---
+// Each segment's index entry has its time range and a bloom filter of actors and targets.
+enum AuditAction {
+    A_NOTE = 0,
+    A_LOGIN,
+    A_LOGOUT,
+    A_ADD_STUDENT,
+    A_ADD_COURSE,
+    A_EDIT_STUDENT,
+    A_EDIT_COURSE,
+    A_DELETE_STUDENT,
+    A_DELETE_COURSE,
+    A_ENROLL,
+    A_DROP,
+    A_EDIT_PROFILE,
+    A_ACTION_COUNT
+};
+const char* const AUDIT_ACTION_NAMES[A_ACTION_COUNT] = {
+    "note", "login", "logout", "add-student", "add-course", "edit-student", "edit-course",
+    "delete-student", "delete-course", "enroll", "drop", "edit-profile"};
+
+const size_t AUDIT_ID_LEN = 24;
+// Student IDs and course codes are validated to fit an audit record whole
+const size_t MAX_ID_LEN = AUDIT_ID_LEN;
+struct AuditEvent {
+    int64_t when;
+    uint8_t action;
+    uint8_t reserved[7];
+    char actor[AUDIT_ID_LEN];
+    char target[AUDIT_ID_LEN];
+};
+const size_t AUDIT_BLOOM_BYTES = 256;
+struct AuditIndexEntry {
+    uint32_t segment, count;
+    int64_t minTime, maxTime;
+    uint8_t bloom[AUDIT_BLOOM_BYTES];
+};
+
+string auditField(const char* f);
+void setAuditField(char* f, string_view s);
+
+// The text line for a structured event, as the free-form log always read
+string describeEvent(int action, const string& actor, const string& target);
+
+// Bloom filter over case-folded IDs, three probes
+void bloomAdd(uint8_t* bloom, const string& key);
+bool bloomMayContain(const uint8_t* bloom, const string& key);
+
+string auditSegmentPath(const string& dir, uint32_t segment);
+
+// Writer side; used only from the Logger's writer thread
+class AuditSegments {
+private:
+    string dir;
+    uint32_t segment;
+    AuditIndexEntry entry;
+    ofstream out;
+    bool dirty;
+
+    void startSegment(uint32_t n);
+    void note(const AuditEvent& e);
+    void writeIndexEntry();
+public:
+    static const uint32_t EVENTS_PER_SEGMENT = 65536;
+
+    AuditSegments() : segment(0), dirty(false) {}
+    // Continue the newest segment, re-reading it to restore its index entry
+    void open(const string& directory);
+    bool isOpen() const { return out.is_open(); }
+    void append(const AuditEvent& e);
+    void flush();
+};
+
+// --- Metrics: per-operation latency histograms ---
+// Per-thread blocks, so the hot path takes no lock; quick calls are timed on a
+// sample. A writer thread merges the blocks into metrics.prom.
+enum MetricId {
+    // Menu handlers
+    M_ADD_STUDENT, M_ADD_COURSE, M_VIEW_STUDENTS, M_VIEW_COURSES, M_COURSE_ROSTER, M_EDIT_STUDENT,
+    M_EDIT_COURSE, M_DELETE_STUDENT, M_DELETE_COURSE, M_FIND_STUDENTS, M_VIEW_PROFILE, M_ENROLL,
+    M_VIEW_ENROLLED, M_EDIT_PROFILE, M_DROP, M_DISPLAY_MODE, M_LOGOUT, M_LOGIN,
+    // Storage primitives
+    M_SCAN, M_INDEX_LOOKUP, M_TEXT_SEARCH, M_JOURNAL_SYNC, M_REWRITE, M_LOG_WRITE, M_REFRESH,
+    M_COUNT
+};
+const MetricId M_FIRST_STORAGE = M_SCAN;
+const char* const METRIC_NAMES[M_COUNT] = {
+    "add_student", "add_course", "view_students", "view_courses", "course_roster", "edit_student",
+    "edit_course", "delete_student", "delete_course", "find_students", "view_profile", "enroll",
+    "view_enrolled", "edit_profile", "drop", "display_mode", "logout", "login",
+    "scan", "index_lookup", "text_search", "journal_sync", "rewrite", "log_write", "refresh"};
+
+// Time this thread spent blocked on input; handlers leave it out
+extern thread_local uint64_t inputWaitNs;
+
+class Metrics {
+public:
+    // Log-linear buckets over nanoseconds: 16 per power of two, so a
+    // quantile is off by at most 1/16 of its value. The last bucket takes
+    // everything from 2^40 ns (18 minutes) up.
+    static const int SUB_BITS = 4;
+    static const int BUCKETS = (41 - SUB_BITS) << SUB_BITS;
+    static int bucketOf(uint64_t ns);
+    // Middle of the bucket's range
+    static double bucketValue(int b);
+    // Written only by the owning thread, read by the writer
+    struct Block {
+        atomic<uint64_t> calls[M_COUNT];
+        atomic<uint64_t> timed[M_COUNT];
+        atomic<uint64_t> timedNs[M_COUNT];
+        atomic<uint64_t> maxNs[M_COUNT];
+        atomic<uint64_t> buckets[M_COUNT][BUCKETS];
+        uint64_t nextTimed[M_COUNT];  // call number to time next
+    };
+    static atomic<bool> enabled;
+    // What one clock read adds to a timed interval
+    static uint64_t clockNs;
+    // Time a timed call must reach to be timed again on the next call
+    static uint64_t everyCallNs;
+
+    static Metrics* getInstance();
+    // Hot path: the calling thread's block, attached on first use
+    static Block* local();
+    static void bump(atomic<uint64_t>& v, uint64_t by) { v.store(v.load(memory_order_relaxed) + by, memory_order_relaxed); }
+    static void record(MetricId id, uint64_t ns);
+    static void addSample(Block* b, MetricId id, uint64_t ns);
+
+    // Starts the writer; later calls only change the path and period
+    void start(const string& file, chrono::milliseconds every);
+    // Writes the file one last time and stops the writer
+    void shutdown();
+    // Every operation seen so far, in the Prometheus text format
+    string render();
+    // Replaces the file, so a scraper never reads half of it
+    bool writeFile(const string& file);
+private:
+    static Metrics* instance;
+    static thread_local Block* localBlock;
+    // Folds a finished thread's counts into retired and frees its block
+    struct Detach {
+        ~Detach();
+    };
+    mutex blocksMutex;
+    vector<Block*> blocks;
+    Block retired{};
+    mutex writerMutex;
+    condition_variable wake;
+    thread writer;
+    string path;
+    chrono::milliseconds period{10000};
+    bool stopping = false;
+
+    Metrics();
+    static Block* attach();
+    void release(Block* b);
+    static void addBlock(const Block& b, vector<uint64_t>& calls, vector<uint64_t>& timed, vector<uint64_t>& timedNs,
+                         vector<uint64_t>& maxNs, vector<uint64_t>& buckets);
+    void run();
+};
+// Interactive and server processes keep this file current for a scraper
+const char* const METRICS_FILE = "metrics.prom";
+const chrono::milliseconds METRICS_PERIOD(10000);
+
+// Counts a scope into one metric and, when its turn comes, times it;
+// M_COUNT records nothing
+class MetricTimer {
+    MetricId id;
+    Metrics::Block* block;
+    uint64_t call;
+    chrono::steady_clock::time_point start;
+    uint64_t waitAtStart;
+public:
+    explicit MetricTimer(MetricId metric);
+    ~MetricTimer();
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+};
+
+// Logger Singleton
+// log() copies into a lock-free ring; a writer thread formats and writes batches.
+// event() also appends to the binary audit log.
+class Logger {
+public:
+    struct FlushPolicy {
+        chrono::milliseconds interval;  // longest time a line may sit unflushed
+        size_t batchSize;               // flush as soon as this many lines are written
+        bool flushOnShutdown;
+    };
+private:
+    friend void benchLogger(size_t threads);
+    static Logger* instance;
+    static const size_t CAPACITY = 4096;  // slots, power of two
+    static const size_t MAX_TEXT = 240;   // longer messages are truncated
+    struct Slot {
+        atomic<size_t> seq;
+        time_t when;
+        int action;
+        // An event's actor and target are text[0, actorLen) and text[actorLen, len)
+        size_t actorLen, len;
+        char text[MAX_TEXT];
+    };
+    unique_ptr<Slot[]> ring;
+    atomic<size_t> head;  // next slot to claim (producers)
+    size_t tail;          // next slot to drain (writer only)
+    atomic<size_t> unflushed;
+    atomic<bool> stopping;
+    // The flush policy, as atomics: producers read the batch size while it may be changed
+    atomic<int64_t> flushIntervalMs;
+    atomic<size_t> flushBatch;
+    atomic<bool> flushOnShutdown;
+    mutex wakeMutex;
+    condition_variable wake;
+    thread writer;
+    ofstream logFile;
+    string auditDir;
+    AuditSegments audit;
+    time_t stampSecond;
+    string stamp;
+
+    explicit Logger(const string& path = "log.txt", const string& auditDirectory = "audit");
+    // Writer side: take every published slot, in order
+    size_t drain(string& batch);
+    void run();
+public:
+    static Logger* getInstance();
+    void setFlushPolicy(const FlushPolicy& p);
+    void log(const string& text);
+    void event(AuditAction action, string_view actor, string_view target = string_view());
+    // Drains the ring and stops the writer; later log() calls are dropped
+    void shutdown();
+    ~Logger() { shutdown(); }
+private:
+    Slot* claim();
+    void publish(Slot* s);
+};
+
+// --- Password hashing: SHA-256, HMAC and PBKDF2 ---
+// Stored form is "$s1$<salt hex>$<hash hex>": PBKDF2-HMAC-SHA256 with a
+// 16-byte random salt and PASSWORD_ITERATIONS rounds. Anything else in the
+// password column is a plaintext password from before hashing was added.
+const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+class Sha256 {
+private:
+    uint32_t h[8];
+    uint8_t block[64];
+    size_t used;
+    uint64_t total;
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+    void compress(const uint8_t* p);
+public:
+    Sha256() { reset(); }
+    void reset();
+    void update(const void* data, size_t n);
+    void final(uint8_t out[32]);
+};
+
+// PBKDF2-HMAC-SHA256, one 32-byte block. The keyed inner and outer states
+// are computed once and copied for each round.
+void pbkdf2Sha256(const string& password, const uint8_t* salt, size_t saltLen, uint32_t iterations, uint8_t out[32]);
+
+const char* const PASSWORD_SCHEME = "$s1$";
+const uint32_t PASSWORD_ITERATIONS = 4096;
+
+string toHex(const uint8_t* p, size_t n);
+bool fromHex(const string& s, vector<uint8_t>& out);
+// Compares without an early exit, so timing does not reveal where they differ
+bool constantTimeEquals(const string& a, const string& b);
+
+bool isHashedPassword(const string& stored);
+
+string hashPassword(const string& password);
+
+// Checks a password against the stored column (hashed, or legacy plaintext)
+bool checkPassword(const string& stored, const string& password);
+
+// --- Record types ---
+struct StudentRecord {
+    string id, name, email, age, program, password;
+};
+struct CourseRecord {
+    string code, name, units, capacity;
+};
+// Seat cap of a course; 0 means no limit
+uint32_t seatLimit(const CourseRecord& c);
+enum EnrollResult { ENROLL_OK, ENROLL_ALREADY, ENROLL_FULL, ENROLL_NOT_FOUND };
+enum UpdateResult { UPDATE_OK, UPDATE_NOT_FOUND, UPDATE_BELOW_ROSTER };
+enum SortKey { SORT_STORED, SORT_ID, SORT_NAME, SORT_AGE };
+
+// Student search; empty or negative fields do not filter
+struct StudentFilter {
+    string program;     // equality, case-insensitive
+    int minAge, maxAge; // inclusive
+    string namePrefix;  // case-insensitive
+};
+// Numeric value of an age field, or -1 if it is not a whole number
+int ageValue(const string& age);
+// Compares a with b after folding ASCII case, without building strings
+int compareFolded(string_view a, string_view b);
+struct Enrollment {
+    string studentId, courseCode;
+};
+// A student read in place from the Registry's columns; it points into them,
+// so it is only valid inside the callback that receives it
+struct StudentView {
+    string_view id, name, email;
+    string age;
+    string_view program, password;
+    StudentRecord record() const { return {string(id), string(name), string(email), age, string(program), string(password)}; }
+};
+StudentView viewOf(const StudentRecord& s);
+struct CourseView {
+    string_view code, name, units, capacity;
+};
+
+// --- Request arena: scratch memory for one menu request ---
+// A monotonic buffer that starts on the handler's stack and is dropped whole.
+class RequestArena {
+    alignas(max_align_t) char initial[16384];
+    pmr::monotonic_buffer_resource pool;
+public:
+    RequestArena() : pool(initial, sizeof(initial)) {}
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+    pmr::memory_resource* resource() { return &pool; }
+    // A copy of s that lives as long as the arena
+    string_view copy(string_view s);
+};
+
+// A column read in place from a mapped snapshot until the first write,
+// which copies it
+template <class T>
+class Column {
+    const T* mapped = nullptr;
+    size_t mappedSize = 0;
+    vector<T> owned;
+public:
+    void adopt(const T* p, size_t n) {
+        vector<T>().swap(owned);
+        mapped = p;
+        mappedSize = n;
+    }
+    size_t size() const { return mapped ? mappedSize : owned.size(); }
+    const T& operator[](size_t i) const { return mapped ? mapped[i] : owned[i]; }
+    vector<T>& edit() {
+        if (mapped) {
+            owned.assign(mapped, mapped + mappedSize);
+            mapped = nullptr;
+        }
+        return owned;
+    }
+    size_t capacity() const { return owned.capacity(); }
+};
+
+class MappedFile;
+
+// --- Student table: one column per field, strings in an arena ---
+// Strings are (offset, length) pairs into 1 MiB blocks, programs are interned
+// and ages are numbers. Replaced strings stay until the arena is compacted.
+// A table adopted from a snapshot reads its columns and strings from the
+// mapping: the pool stands in for the first blocks.
+class StudentTable {
+public:
+    struct Ref {
+        uint32_t at, len;
+    };
+private:
+    static const uint32_t BLOCK_BITS = 20, BLOCK_SIZE = 1u << BLOCK_BITS, MAX_BLOCKS = 1u << (32 - BLOCK_BITS);
+    // Where each block starts; owned blocks follow the mapped ones
+    vector<const char*> bases;
+    vector<unique_ptr<char[]> > blocks;
+    shared_ptr<const MappedFile> file;
+    uint32_t used;
+    size_t arenaBytes, liveBytes;
+    Column<Ref> ids, names, emails, passwords;
+    Column<uint32_t> programs;
+    // The age, or -1 - index into oddAges for text that does not read back
+    // as the same number (blank, "020", "twenty")
+    Column<int32_t> ages;
+    vector<string> programNames, oddAges;
+    unordered_map<string, uint32_t> programIds, oddAgeIds;
+    uint32_t lastProgram;
+
+    Ref store(string_view s);
+    string_view text(Ref r) const;
+    static uint32_t intern(string_view s, vector<string>& names, unordered_map<string, uint32_t>& ids);
+    // Rows mostly repeat a recent program; that skips the map and its key copy
+    uint32_t internProgram(string_view s);
+    int32_t encodeAge(string_view age);
+    void release(size_t i) { liveBytes -= ids[i].len + names[i].len + emails[i].len + passwords[i].len; }
+public:
+    StudentTable() : used(0), arenaBytes(0), liveBytes(0), lastProgram(0) {}
+    size_t size() const { return ids.size(); }
+    void reserve(size_t n);
+    void clear() { *this = StudentTable(); }
+    // Takes the rows from a snapshot's columns; refs are offsets into pool,
+    // which must outlive the table. Fails on anything out of range.
+    bool adopt(shared_ptr<const MappedFile> from, const char* pool, uint64_t poolSize, const Ref* const columns[4],
+               const uint32_t* programColumn, const int32_t* ageColumn, size_t n, vector<string> programList,
+               vector<string> oddAgeList, uint64_t stringBytes);
+    // Copies whatever still lives in the mapping
+    void detach();
+    void append(string_view id, string_view name, string_view email, string_view age, string_view program, string_view password);
+    void append(const StudentRecord& s) { append(s.id, s.name, s.email, s.age, s.program, s.password); }
+    // Overwrites row i; the old strings become garbage, reclaimed once it
+    // outweighs the live data
+    void assign(size_t i, const StudentView& s);
+    string_view id(size_t i) const { return text(ids[i]); }
+    string_view name(size_t i) const { return text(names[i]); }
+    string_view email(size_t i) const { return text(emails[i]); }
+    string_view password(size_t i) const { return text(passwords[i]); }
+    uint32_t programId(size_t i) const { return programs[i]; }
+    const string& program(size_t i) const { return programNames[programs[i]]; }
+    size_t programCount() const { return programNames.size(); }
+    const string& programName(uint32_t p) const { return programNames[p]; }
+    // Ages as stored, for the snapshot
+    int32_t ageCode(size_t i) const { return ages[i]; }
+    size_t oddAgeCount() const { return oddAges.size(); }
+    const string& oddAge(size_t a) const { return oddAges[a]; }
+    size_t stringBytes() const { return liveBytes; }
+    // Numeric age as ageValue() reads it, or -1
+    int age(size_t i) const { return ages[i] >= 0 ? ages[i] : ageValue(oddAges[-1 - ages[i]]); }
+    string ageText(size_t i) const { return ages[i] >= 0 ? to_string(ages[i]) : oddAges[-1 - ages[i]]; }
+    StudentView view(size_t i) const { return {id(i), name(i), email(i), ageText(i), program(i), password(i)}; }
+    StudentRecord record(size_t i) const { return view(i).record(); }
+
+    // Compaction: rows move down over removed ones, then the table is cut
+    void moveRow(size_t from, size_t to);
+    void truncate(size_t n);
+    size_t garbageBytes() const { return arenaBytes - liveBytes; }
+    // Copies the strings still in use into fresh blocks; views taken before are void
+    void compactArena();
+    // Heap bytes held, garbage included
+    size_t memoryBytes() const;
+};
+
+// --- Persistence: the only code that touches the data files ---
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+uint32_t fnv1a(const char* data, size_t n);
+bool syncFd(int fd);
+bool syncPath(const string& path);
+// Makes renames in the data directory durable; on Windows the renames
+// themselves are written through instead
+bool syncDirectory();
+// Puts from in place of to in one step; there is no moment without a "to"
+bool replaceFile(const string& from, const string& to);
+
+// Replaces several files as one: the synced manifest's rename is the commit point;
+// after it, rollForward() at startup finishes the renames.
+class FileTransaction {
+private:
+    vector<string> targets;
+    static string staged(const string& target) { return target + ".tmp"; }
+    static void writeSynced(const string& path, const string& data);
+    static void renameAll(const vector<string>& names);
+public:
+    static const char* const MANIFEST;
+    // write(out) produces the new contents of target
+    template <class Write>
+    void stage(const string& target, Write write) {
+        string tmp = staged(target);
+        {
+            ofstream fout(tmp.c_str(), ios::binary | ios::trunc);
+            write(fout);
+            if (!fout.flush()) throw runtime_error("Cannot write " + tmp);
+        }
+        if (!syncPath(tmp)) throw runtime_error("Cannot sync " + tmp);
+        targets.push_back(target);
+    }
+    void commit();
+    // Finishes a transaction that committed but did not get to all its renames
+    static void rollForward();
+};
+
+class RecordFiles {
+public:
+    // Each file is read with one allocation and split in place. The loads
+    // return how many bytes they read, for the Registry to carry on from.
+    template <class Row>
+    static uint64_t forEachRow(const char* path, size_t fields, Row row) {
+        string data = readWholeFile(path);
+        forEachCsvLine(data, fields, row);
+        return data.size();
+    }
+    static uint64_t loadStudents(StudentTable& out);
+    // Files written before capacities existed have no 4th column
+    static CourseRecord courseRow(const string_view* f);
+    static uint64_t loadCourses(vector<CourseRecord>& out);
+    // Enrollment rows are handed over as views; the Registry only needs slots
+    template <class Row>
+    static uint64_t loadEnrollments(Row row) {
+        return forEachRow("enrollments.txt", 2, [&row](const string_view* f) { row(f[0], f[1]); });
+    }
+
+    static void writeStudent(ostream& out, const StudentView& s);
+    static void writeCourse(ostream& out, const CourseRecord& c);
+    static void writeEnrollment(ostream& out, const Enrollment& e);
+
+    // Checkpoints render all three files, then stage them in one transaction
+    static string renderStudents(const StudentTable& v, const vector<char>& live);
+    static string renderCourses(const vector<CourseRecord>& v, const vector<char>& live);
+    // Accounts without a student record (only "admin"): "id,<password hash>" rows
+    static void loadCredentials(vector<pair<string, string> >& out);
+    static void saveCredentials(const vector<pair<string, string> >& v);
+    static void stageFile(FileTransaction& tx, const string& target, const string& data);
+};
+
+// --- Journal: append-only write-ahead log of mutations ---
+// Entry: [u32 length][u32 checksum][u8 op][u16 size + bytes per field]. Replayed
+// at startup; writers waiting at once share one fsync.
+enum JournalOp {
+    J_ADD_STUDENT = 1,
+    J_UPDATE_STUDENT,
+    J_REMOVE_STUDENT,
+    J_ADD_COURSE,
+    J_UPDATE_COURSE,
+    J_REMOVE_COURSE,
+    J_ENROLL,
+    J_DROP
+};
+
+struct JournalEntry {
+    int op;
+    vector<string> fields;
+};
+
+// A change was applied but its journal entry could not be written yet; the
+// entry stays queued for the next sync or checkpoint
+class JournalError : public runtime_error {
+public:
+    explicit JournalError(const string& what) : runtime_error(what) {}
+};
+
+class Journal {
+private:
+    string path;
+    int fd;
+    // Entries and bytes staged since the last reset, synced or not
+    size_t entries;
+    size_t bytes;
+    mutex m;
+    condition_variable synced;
+    // Staged bytes, and the buffer the last batch was written from, kept so
+    // staging reuses its capacity instead of growing a fresh string
+    string pending, spare;
+    uint64_t stagedSeq, syncedSeq;
+    // Length of the journal file up to its last good sync
+    uint64_t durable;
+    bool syncing;
+    // Failed attempts so far and the last entry the latest one covered. If
+    // a torn write could not be cut off, nothing more is written until reset().
+    uint64_t failures, failedUpTo;
+    bool torn;
+    size_t syncs;
+
+    static void setU32(string& out, size_t at, uint32_t v);
+    static uint32_t getU32(const string& in, size_t at);
+    void openForAppend(bool truncate);
+    // Parse one entry starting at pos; returns false on a torn or corrupt entry
+    static bool decode(const string& data, size_t& pos, JournalEntry& out);
+public:
+    explicit Journal(const string& file);
+    ~Journal();
+    size_t entryCount() const { return entries; }
+    size_t byteCount() const { return bytes; }
+    size_t syncCount();
+
+    // Entries of a rotated file come before those of the current one
+    string rotatedPath() const { return path + ".old"; }
+    template <class Apply>
+    size_t applyAll(const string& data, Apply& apply) {
+        size_t pos = 0;
+        JournalEntry e;
+        while (pos < data.size() && decode(data, pos, e)) {
+            apply(e);
+            ++entries;
+        }
+        return pos;
+    }
+    // Hands every complete entry to apply() and returns the file and the
+    // length of its intact prefix; an entry still being appended ends it
+    template <class Apply>
+    size_t read(Apply apply, string& data) {
+        applyAll(readWholeFile(rotatedPath().c_str()), apply);
+        {
+            ifstream fin(path.c_str(), ios::binary);
+            data.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+        }
+        return applyAll(data, apply);
+    }
+    template <class Apply>
+    void read(Apply apply) {
+        string data;
+        bytes = read(apply, data);
+    }
+    // As read(), then cuts off a torn tail and opens for appending
+    template <class Apply>
+    void replay(Apply apply) {
+        string data;
+        size_t pos = read(apply, data);
+        bytes = pos;
+        durable = pos;
+        if (pos < data.size()) {
+            // Rewrite just the intact prefix
+            openForAppend(true);
+            if (pos > 0 && (write(fd, data.data(), (unsigned)pos) != (long)pos || !syncFd(fd)))
+                throw runtime_error("Cannot repair journal " + path);
+        } else {
+            openForAppend(false);
+        }
+    }
+    // Hands every entry to apply() again, the synced ones and those still
+    // queued, leaving the journal as it is
+    template <class Apply>
+    void reread(Apply apply) {
+        string queued;
+        uint64_t written;
+        {
+            unique_lock<mutex> lock(m);
+            while (syncing) synced.wait(lock);
+            queued = pending;
+            written = durable;
+        }
+        string data = readWholeFile(rotatedPath().c_str());
+        size_t pos = 0;
+        JournalEntry e;
+        while (pos < data.size() && decode(data, pos, e)) apply(e);
+        data = readFileRange(path.c_str(), 0, written);
+        pos = 0;
+        while (pos < data.size() && decode(data, pos, e)) apply(e);
+        pos = 0;
+        while (pos < queued.size() && decode(queued, pos, e)) apply(e);
+    }
+    // Returns the entry's sequence number, for sync(). The payload is built
+    // in place after its header, which is filled in once the checksum is known.
+    uint64_t stage(int op, initializer_list<string_view> fields);
+    // Returns once entry seq is on disk. Throws JournalError if the attempt
+    // that covered it failed; the entry is then retried by the next sync.
+    void sync(uint64_t seq);
+    void commit();
+    // Called once the text files hold everything staged so far, synced or
+    // not: the entries are dropped and their writers released as durable
+    void reset();
+    // Moves the file aside for a checkpoint written off the lock and starts
+    // a fresh one, which gets the entries not yet synced. False while an
+    // earlier rotated file is still there.
+    bool rotate();
+    // The checkpoint covering the rotated file is on disk
+    void dropRotated();
+};
+
+// --- Snapshot: binary image of the Registry, loaded with mmap ---
+// Ignored once any text file no longer matches the stat recorded in its header.
+struct SnapString {
+    uint32_t off, len;
+};
+struct SnapCourse {
+    SnapString code, name, units, capacity;
+};
+struct SnapHeader {
+    char magic[8];
+    uint32_t version, byteOrder;
+    uint64_t sourceSize[3], sourceInode[3];
+    int64_t sourceMtimeNs[3];
+    uint64_t studentCount, courseCount, enrollmentCount;
+    uint64_t studentBuckets, courseBuckets, studentKeys, courseKeys;
+    uint64_t studentsAt, coursesAt, studentEdgesAt, courseEdgesAt;
+    uint64_t studentIndexAt, courseIndexAt, poolAt, poolSize, fileSize;
+    // Students are stored by column: id, name, email and password strings,
+    // program ids, age codes, then the program names and odd ages
+    uint64_t programCount, oddAgeCount, studentStringBytes;
+    // byName, then byAge and byProgram as CSR; secondaryAt is 0 if they
+    // were stale when the snapshot was taken
+    uint64_t secondaryAt, nameCount, programListCount;
+};
+const char SNAP_MAGIC[8] = {'S', 'M', 'S', 'S', 'N', 'A', 'P', 0};
+const uint32_t SNAP_VERSION = 4;
+const char* const SNAP_SOURCES[3] = {"students.txt", "courses.txt", "enrollments.txt"};
+
+// Identity, size and modification time of a data file; mtimeNs is -1 if it is missing
+struct SourceStat {
+    uint64_t device, inode, size;
+    int64_t mtimeNs;
+    bool operator==(const SourceStat& o) const;
+    bool operator!=(const SourceStat& o) const { return !(*this == o); }
+};
+// Nanoseconds where the platform keeps them: a same-size edit within the
+// second of a checkpoint must still show
+SourceStat statSource(const char* path);
+
+// How far the Registry has read into one of SNAP_SOURCES: the bytes before
+// offset are loaded. A hash of the last few of them tells a file that was
+// only appended to (it still matches) from one rewritten in place.
+struct SourceMark {
+    SourceStat file;
+    uint64_t offset;
+    uint32_t tailHash;
+    bool lineEnd;  // the loaded bytes end with a newline, or there are none
+};
+enum SourceChange { SOURCE_SAME, SOURCE_APPENDED, SOURCE_REWRITTEN };
+const uint64_t MARK_BYTES = 4096;
+// What the Registry did about changes made to the text files by other programs
+struct SourceRefresh {
+    size_t rows;
+    bool reloaded;
+};
+
+SourceMark markSource(const char* path, uint64_t offset);
+// Only a stat, unless the file has changed
+SourceChange compareSource(const char* path, const SourceMark& m);
+bool sourceMoved(const char* path, const SourceMark& m);
+
+// Read-only view of a whole file
+class MappedFile {
+private:
+    const char* base;
+    size_t length;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+public:
+    MappedFile();
+    ~MappedFile();
+    bool open(const string& path);
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+};
+
+// Accumulates the snapshot image; sections are 8-byte aligned
+class SnapWriter {
+public:
+    string out, pool;
+    uint64_t section();
+    template <class T>
+    void put(const T& v) { out.append((const char*)&v, sizeof(T)); }
+    SnapString str(string_view s);
+};
+
+// --- Process lock: one process at a time owns the data files ---
+// Held for the life of the process; the OS drops it if the process dies.
+// Shared holders keep out an exclusive one but not each other; wait blocks
+// until the lock is granted instead of failing.
+class ProcessLock {
+    int fd = -1;
+public:
+#ifdef _WIN32
+    bool acquire(const string& path, bool shared = false, bool wait = false);
+    ~ProcessLock() { if (fd >= 0) _close(fd); }
+#else
+    bool acquire(const string& path, bool shared = false, bool wait = false);
+    ~ProcessLock() { if (fd >= 0) ::close(fd); }
+#endif
+};
+
+// --- Edge lists: a sorted list of slots per row, for the enrollment index ---
+// Rows adopted from a snapshot are read in place from its CSR section; a row
+// is copied out the first time it is written.
+class EdgeLists {
+public:
+    struct Row {
+        const uint32_t* first;
+        size_t n;
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return first + n; }
+        size_t size() const { return n; }
+        bool empty() const { return n == 0; }
+        uint32_t operator[](size_t i) const { return first[i]; }
+    };
+private:
+    shared_ptr<const MappedFile> file;
+    const uint32_t* offsets = nullptr;
+    const uint32_t* targets = nullptr;
+    size_t mappedRows = 0;
+    vector<char> copied;
+    vector<vector<uint32_t> > rows;
+    bool inMapping(size_t i) const { return i < mappedRows && !copied[i]; }
+public:
+    size_t size() const { return rows.size(); }
+    Row operator[](size_t i) const;
+    vector<uint32_t>& edit(size_t i);
+    void addRow() { rows.emplace_back(); }
+    void clear() { *this = EdgeLists(); }
+    // For changes to every row at once: copies out all that are still mapped
+    vector<vector<uint32_t> >& own();
+    // CSR: n+1 row offsets followed by the edge targets, each below limit
+    // and sorted within its row
+    bool adopt(shared_ptr<const MappedFile> from, const uint32_t* csr, size_t n, size_t edges, size_t limit);
+};
+
+// --- Registry Singleton: all records, loaded once at startup ---
+// Slots are kept for life until compaction. Mutations go to the journal; the text
+// files and snapshot are only rewritten at checkpoints.
+class Registry {
+private:
+    friend void benchStartup(size_t n);
+    friend bool benchTail(size_t n);
+    friend bool benchSeats(size_t threads);
+    friend void benchCommit(size_t maxThreads);
+    friend void benchRush(size_t n, size_t ops, size_t threads);
+    static Registry* instance;
+    StudentTable students;
+    vector<char> studentLive;
+    size_t deadStudents;
+    vector<CourseRecord> courses;
+    vector<char> courseLive;
+    size_t deadCourses;
+    EdgeLists studentCourses, courseStudents;
+    size_t enrollmentCount;
+    FoldedKeyIndex studentIds, courseCodes;
+    Journal journal;
+    bool snapshotCurrent;
+    bool grouping;
+    // Another process owns the data files; mutations are refused
+    bool readOnly;
+    ProcessLock dataLock;
+    mutable shared_mutex rw;
+    // Seats reserved but not yet enrolled, per course slot; enrolled plus
+    // reserved never exceeds the cap. Compaction renumbers slots, so it
+    // clears the counters and bumps the generation to void open reservations.
+    mutable deque<atomic<uint32_t> > pendingSeats;
+    uint64_t slotGeneration;
+    // Bumped whenever student or course slots are renumbered; page cursors
+    // holding a slot are only good for the layout they were taken in
+    uint64_t slotLayout;
+    // Secondary indexes, all holding live student slots: per folded program
+    // ordered by (age, slot); per age (slot order); and all ordered by
+    // (folded name, slot). While dirty they are stale and searches scan.
+    unordered_map<string, vector<uint32_t> > byProgram;
+    vector<vector<uint32_t> > byAge;
+    vector<uint32_t> byName;
+    // byProgram key of each interned program, folded once
+    vector<string> programKeys;
+    bool secondaryDirty;
+    size_t groupIndexOps;
+    static const int MAX_INDEXED_AGE = 150;
+    static const size_t BULK_INDEX_OPS = 4096;
+    // Text search over student ID/name/email and course code/name. Searches
+    // build them under the shared lock, hence mutable and the build mutex.
+    mutable TextIndex studentText, courseText;
+    mutable atomic<bool> textReady;
+    mutable mutex textBuild;
+    // How far each of SNAP_SOURCES has been read
+    SourceMark sources[3];
+    // Threshold checkpoints write their files on this thread, off the lock;
+    // the journal entries they cover were rotated aside
+    thread checkpointer;
+    bool checkpointRunning;
+    condition_variable_any checkpointDone;
+    // What a checkpoint writes, rendered under the lock
+    struct CheckpointImage {
+        bool text;
+        string students, courses, enrollments, snapshot;
+        SourceMark marks[3];
+    };
+
+    // Checkpoint once the journal holds this many entries or bytes
+    static const size_t CHECKPOINT_ENTRIES = 1000;
+    static const size_t CHECKPOINT_BYTES = 1 << 20;
+
+    // With shareFiles, data files owned by another process are loaded
+    // read-only instead of refused: nothing is repaired or written back.
+    explicit Registry(bool shareFiles = false);
+    ~Registry();
+    // The owner holds this exclusively while it rewrites the data files, and
+    // read-only loaders hold it shared, so neither sees the other half done
+    static void lockFiles(ProcessLock& files, bool shared);
+    void loadText();
+    // Students and the enrollment index stay in the mapping, read in place
+    // until first written; courses and the key indexes are copied out
+    bool loadSnapshot(const string& path);
+    // Copies the secondary indexes out; false leaves them to be rebuilt
+    bool loadSecondary(const char* base, const SnapHeader& h, size_t ns);
+    // CSR section: n+1 row offsets followed by the edge targets
+    static bool readEdges(const uint32_t* csr, size_t n, size_t edges, size_t targets, vector<vector<uint32_t> >& lists);
+    template <class Lists>
+    static void writeEdges(SnapWriter& w, const Lists& lists) {
+        uint32_t at = 0;
+        w.put(at);
+        for (size_t i = 0; i < lists.size(); ++i) {
+            at += (uint32_t)lists[i].size();
+            w.put(at);
+        }
+        for (size_t i = 0; i < lists.size(); ++i)
+            if (!lists[i].empty()) w.out.append((const char*)&*lists[i].begin(), lists[i].size() * 4);
+    }
+    // The stats of the text files it matches are filled in by stampSnapshot
+    // once they are on disk
+    string renderSnapshot();
+    static void stampSnapshot(string& image);
+    static void sortUnique(vector<uint32_t>& v);
+    static bool insertSorted(vector<uint32_t>& v, uint32_t x);
+    static bool eraseSorted(vector<uint32_t>& v, uint32_t x);
+    // Slots are compacted in order, so remapped lists stay sorted
+    static void remap(vector<vector<uint32_t> >& lists, const vector<uint32_t>& newSlot);
+    // Enrollments are rendered straight from the index
+    string renderEnrollments() const;
+    void rebuildStudentIndex();
+    void rebuildCourseIndex();
+    void compactStudents();
+    // Order of the program lists and of byName
+    bool programLess(uint32_t a, uint32_t b) const;
+    bool nameLess(uint32_t a, uint32_t b) const;
+    int ageBucket(uint32_t slot) const;
+    void rebuildSecondary();
+    const string& programKey(uint32_t program);
+    // Bulk changes stop index upkeep and rebuild once instead
+    bool secondaryLive();
+    void indexStudent(uint32_t slot);
+    // Must run while the record still holds the values it was indexed under
+    void unindexStudent(uint32_t slot);
+    // The email's domain is shared by nearly everyone, so only its local part is searched
+    static string searchText(const StudentView& s);
+    static string searchText(const CourseRecord& c) { return c.code + " " + c.name; }
+    // Caller holds the lock shared or exclusively
+    void buildText() const;
+    void dropText();
+    // Past the bulk threshold the text indexes are dropped for the next search to rebuild
+    bool textLive();
+    size_t resumeSlot(const vector<char>& live, size_t slot, uint64_t layout, size_t skip) const;
+    void resetSeats();
+    // Caller holds the lock shared; the course's roster cannot change meanwhile
+    bool reserveSeat(long c) const;
+    void compactCourses();
+    struct StudentKey {
+        const StudentTable* v;
+        string_view operator()(uint32_t slot) const { return v->id(slot); }
+    };
+    struct CourseKey {
+        const vector<CourseRecord>* v;
+        const string& operator()(uint32_t slot) const { return (*v)[slot].code; }
+    };
+    StudentKey studentKey() const { return StudentKey{&students}; }
+    StudentView copyStudent(size_t i, RequestArena& a) const;
+    CourseKey courseKey() const { return CourseKey{&courses}; }
+    long studentIndex(string_view id) const;
+    long courseIndex(string_view code) const;
+public:
+    static Registry* getInstance();
+    // For a process that only reads: works alongside a running server
+    static Registry* getReadOnlyInstance();
+
+    // Lookups (student IDs and course codes are case-insensitive)
+    bool hasStudent(string_view id) const;
+    bool hasCourse(string_view code) const;
+    bool findStudent(string_view id, StudentRecord& out) const;
+    // Copies into the request's arena: the view stays valid after the lock is
+    // released, for as long as the arena lives
+    bool findStudent(string_view id, StudentView& out, RequestArena& arena) const;
+    bool findCourse(string_view code, CourseRecord& out) const;
+    bool isEnrolled(string_view sid, string_view code) const;
+    vector<CourseRecord> coursesOf(string_view sid) const;
+    pmr::vector<CourseView> coursesOf(string_view sid, RequestArena& arena) const;
+    size_t rosterSize(string_view code) const;
+    vector<StudentRecord> studentsIn(string_view code) const;
+    // fn(student) for each student enrolled in the course, under the shared lock
+    template <class Fn>
+    void forEachInCourse(string_view code, Fn fn) const {
+        MetricTimer timer(M_SCAN);
+        shared_lock<shared_mutex> lock(rw);
+        long c = courseIndex(code);
+        if (c < 0) return;
+        EdgeLists::Row list = courseStudents[c];
+        for (size_t i = 0; i < list.size(); ++i) fn(students.view(list[i]));
+    }
+    // The roster paged like resumeStudents: it is sorted by slot, so a slot
+    // from the same layout resumes by binary search
+    template <class Fn>
+    void resumeCourse(string_view code, size_t& slot, uint64_t& layout, size_t skip, Fn fn) const {
+        MetricTimer timer(M_SCAN);
+        shared_lock<shared_mutex> lock(rw);
+        long c = courseIndex(code);
+        if (c < 0) return;
+        EdgeLists::Row list = courseStudents[c];
+        size_t i = layout == slotLayout ? lower_bound(list.begin(), list.end(), slot) - list.begin()
+                                        : min(skip, list.size());
+        for (; i < list.size(); ++i)
+            if (!fn(students.view(list[i]))) break;
+        slot = i < list.size() ? list[i] : students.size();
+        layout = slotLayout;
+    }
+    size_t enrollmentTotal() const;
+    // fn runs under the shared lock and must not call back into the Registry
+    template <class Fn>
+    void forEachStudent(Fn fn) const {
+        MetricTimer timer(M_SCAN);
+        shared_lock<shared_mutex> lock(rw);
+        for (size_t i = 0; i < students.size(); ++i)
+            if (studentLive[i]) fn(students.view(i));
+    }
+    template <class Fn>
+    void forEachCourse(Fn fn) const {
+        MetricTimer timer(M_SCAN);
+        shared_lock<shared_mutex> lock(rw);
+        for (size_t i = 0; i < courses.size(); ++i)
+            if (courseLive[i]) fn(courses[i]);
+    }
+    // fn(course, number of students enrolled)
+    template <class Fn>
+    void forEachCourseSeats(Fn fn) const {
+        MetricTimer timer(M_SCAN);
+        shared_lock<shared_mutex> lock(rw);
+        for (size_t i = 0; i < courses.size(); ++i)
+            if (courseLive[i]) fn(courses[i], courseStudents[i].size());
+    }
+    // Stored-order paging: fn(row) for the live rows from slot on, until it
+    // returns false; slot comes back as the row to resume at. A cursor from
+    // another layout skips skip live rows from the start instead.
+    template <class Fn>
+    void resumeStudents(size_t& slot, uint64_t& layout, size_t skip, Fn fn) const {
+        MetricTimer timer(M_SCAN);
+        shared_lock<shared_mutex> lock(rw);
+        size_t i = resumeSlot(studentLive, slot, layout, skip);
+        for (; i < students.size(); ++i)
+            if (studentLive[i] && !fn(students.view(i))) break;
+        slot = i;
+        layout = slotLayout;
+    }
+    // fn(course, number of students enrolled), paged the same way
+    template <class Fn>
+    void resumeCourseSeats(size_t& slot, uint64_t& layout, size_t skip, Fn fn) const {
+        MetricTimer timer(M_SCAN);
+        shared_lock<shared_mutex> lock(rw);
+        size_t i = resumeSlot(courseLive, slot, layout, skip);
+        for (; i < courses.size(); ++i)
+            if (courseLive[i] && !fn(courses[i], courseStudents[i].size())) break;
+        slot = i;
+        layout = slotLayout;
+    }
+    // fn(student) for each student matching the filter. The narrowest index
+    // the filter allows drives the scan, so the cost follows the number of
+    // candidates it yields rather than the number of students.
+    template <class Fn>
+    void forEachMatch(const StudentFilter& f, Fn fn) const {
+        MetricTimer timer(M_SCAN);
+        shared_lock<shared_mutex> lock(rw);
+        string program = foldCase(trim(f.program));
+        int lo = f.minAge < 0 ? 0 : f.minAge, hi = f.maxAge < 0 ? INT_MAX : f.maxAge;
+        bool ageFilter = f.minAge >= 0 || f.maxAge >= 0;
+        if (lo > hi) return;
+        // Programs are compared once per distinct spelling, not once per student
+        vector<char> programOk;
+        if (!program.empty()) {
+            programOk.resize(students.programCount());
+            for (uint32_t p = 0; p < programOk.size(); ++p) programOk[p] = compareFolded(trim(students.programName(p)), program) == 0;
+        }
+        auto matches = [&](uint32_t slot) {
+            if (!program.empty() && !programOk[students.programId(slot)]) return false;
+            int age = students.age(slot);
+            if (ageFilter && (age < lo || age > hi)) return false;
+            return f.namePrefix.empty() || compareFolded(students.name(slot).substr(0, f.namePrefix.size()), f.namePrefix) == 0;
+        };
+        if (secondaryDirty) {
+            for (size_t i = 0; i < students.size(); ++i)
+                if (studentLive[i] && matches((uint32_t)i)) fn(students.view(i));
+            return;
+        }
+
+        // Candidate ranges from each index the filter touches
+        const uint32_t* best = nullptr;
+        size_t bestCount = SIZE_MAX;
+        if (!program.empty()) {
+            auto it = byProgram.find(program);
+            if (it == byProgram.end()) return;
+            // Ordered by age, so an age range narrows it to a sub-range
+            const vector<uint32_t>& list = it->second;
+            auto first = list.begin(), last = list.end();
+            if (ageFilter) {
+                first = lower_bound(first, last, lo, [this](uint32_t slot, int age) { return students.age(slot) < age; });
+                last = upper_bound(first, last, hi, [this](int age, uint32_t slot) { return age < students.age(slot); });
+            }
+            best = list.data() + (first - list.begin());
+            bestCount = (size_t)(last - first);
+        }
+        if (!f.namePrefix.empty()) {
+            string_view prefix = f.namePrefix;
+            auto headOf = [this, prefix](uint32_t slot) { return students.name(slot).substr(0, prefix.size()); };
+            auto first = lower_bound(byName.begin(), byName.end(), prefix,
+                                     [&](uint32_t slot, string_view p) { return compareFolded(headOf(slot), p) < 0; });
+            auto last = upper_bound(first, byName.end(), prefix,
+                                    [&](string_view p, uint32_t slot) { return compareFolded(p, headOf(slot)) < 0; });
+            if ((size_t)(last - first) < bestCount) {
+                best = byName.data() + (first - byName.begin());
+                bestCount = (size_t)(last - first);
+            }
+        }
+        if (ageFilter && lo <= hi) {
+            // Ages past MAX_INDEXED_AGE share the last bucket; matches() sorts them out
+            int from = min(lo, MAX_INDEXED_AGE), to = min(hi, MAX_INDEXED_AGE);
+            size_t count = 0;
+            for (int a = from; a <= to; ++a) count += byAge[a].size();
+            if (count < bestCount) {
+                for (int a = from; a <= to; ++a)
+                    for (size_t j = 0; j < byAge[a].size(); ++j)
+                        if (matches(byAge[a][j])) fn(students.view(byAge[a][j]));
+                return;
+            }
+        }
+        if (!best) {
+            for (size_t i = 0; i < students.size(); ++i)
+                if (studentLive[i] && matches((uint32_t)i)) fn(students.view(i));
+            return;
+        }
+        for (size_t j = 0; j < bestCount; ++j)
+            if (matches(best[j])) fn(students.view(best[j]));
+    }
+    // Up to k students whose ID, name or email resemble the query, best first;
+    // the last word of the query may be cut short
+    vector<StudentRecord> searchStudents(string_view query, size_t k) const;
+    // Same for course codes and names
+    vector<CourseRecord> searchCourses(string_view query, size_t k) const;
+    // fn(student, course) for every enrollment, grouped by student
+    template <class Fn>
+    void forEachEnrollment(Fn fn) const {
+        MetricTimer timer(M_SCAN);
+        shared_lock<shared_mutex> lock(rw);
+        for (size_t s = 0; s < students.size(); ++s) {
+            EdgeLists::Row list = studentCourses[s];
+            if (list.empty()) continue;
+            StudentView student = students.view(s);
+            for (size_t j = 0; j < list.size(); ++j) fn(student, courses[list[j]]);
+        }
+    }
+
+    // Mutations: applied in memory and journaled under the write lock, then
+    // acknowledged once the journal sync, shared with other writers, is done
+    void addStudent(const StudentRecord& s);
+    void addCourse(const CourseRecord& c);
+    bool updateStudent(const StudentRecord& s) { return updateStudent(viewOf(s)); }
+    bool updateStudent(const StudentView& s);
+    // A cap below the students already enrolled is refused
+    UpdateResult updateCourse(const CourseRecord& c);
+    bool removeStudent(const string& id);
+    bool removeCourse(const string& code);
+    // Reserve a seat under the shared lock, then enroll under the write lock
+    EnrollResult enroll(string_view sid, string_view code);
+    bool drop(string_view sid, string_view code);
+
+    // Group commit: mutations between the two calls reach the journal with one
+    // sync. No checkpoint is taken here; bulk callers checkpoint once at the end.
+    void beginGroup();
+    void commitGroup();
+
+    // Fold the journal into the text files and refresh the snapshot
+    void checkpoint();
+    // Catches up with what other programs did to the text files. Nothing
+    // but a stat per file unless one of them changed.
+    SourceRefresh refreshSources();
+private:
+    SourceRefresh absorbSources();
+    // Applies the complete rows added to source i since its mark; a row cut
+    // short waits for its newline. As at load, the first row with an ID wins.
+    size_t tailSource(int i);
+    // Starts over from the text files, with the journal replayed on top
+    void reloadLocked();
+    // Text files are rendered only when the journal holds something for them
+    CheckpointImage renderCheckpoint();
+    // Touches no Registry state, so it can run without the lock
+    static void writeCheckpoint(CheckpointImage& image);
+    void installCheckpoint(const CheckpointImage& image);
+    // Caller holds the lock, with no checkpoint running
+    void checkpointLocked();
+    // The files are rendered and the journal rotated under the lock, then
+    // written by the checkpointer while mutations carry on into the new journal
+    void startCheckpoint();
+    // Returns the journal sequence number to sync on; grouped entries wait for commitGroup
+    uint64_t record(int op, initializer_list<string_view> fields);
+
+    // Each apply is idempotent, so replaying an entry that already reached
+    // the text files is harmless
+    void applyEntry(const JournalEntry& e);
+    void applyAddStudent(const StudentRecord& s);
+    void applyAddCourse(const CourseRecord& c);
+    bool applyUpdateStudent(const StudentView& s);
+    bool applyUpdateCourse(const CourseRecord& c);
+    bool applyRemoveStudent(const string& id);
+    bool applyRemoveCourse(const string& code);
+    bool applyEnroll(string_view sid, string_view code);
+    bool applyDrop(string_view sid, string_view code);
+};
+
+// --- Source watcher: keeps the Registry current with outside edits ---
+// inotify on Linux, polling elsewhere; refreshSources() does the work.
+class SourceWatcher {
+private:
+    static SourceWatcher* instance;
+    static const int POLL_MS = 1000;
+    // With inotify, a slow poll as well, in case the queue overflowed
+    static const int SAFETY_POLL_MS = 30000;
+    // Writes tend to come in bursts; one refresh covers the lot
+    static const int SETTLE_MS = 20;
+    thread worker;
+    mutex m;
+    condition_variable wake;
+    bool stopping;
+    int notifyFd;
+#ifndef _WIN32
+    int stopPipe[2];
+#endif
+
+    SourceWatcher();
+    void refresh();
+#ifdef __linux__
+    // True if any event names one of the data files
+    bool drainEvents();
+    void runNotify();
+#endif
+    void runPoll();
+public:
+    static SourceWatcher* getInstance();
+    void start();
+    void shutdown();
+};
+
+// --- Credential store: password hashes for every account, by case-folded ID ---
+// The admin hash lives in credentials.txt. A repeated login costs one keyed
+// hash; wrong passwords and unknown IDs always pay the full hash.
+class CredentialStore {
+private:
+    static CredentialStore* instance;
+    string adminHash, dummyHash;
+    uint8_t cacheKey[32];
+    mutex cacheLock;
+    unordered_map<string, string> verified;
+    static const size_t CACHE_LIMIT = 100000;
+
+    CredentialStore();
+    string cacheDigest(const string& stored, const string& password);
+    bool verify(const string& key, const string& stored, const string& password);
+public:
+    enum Access { NO_ACCESS, ADMIN_ACCESS, STUDENT_ACCESS };
+    static CredentialStore* getInstance();
+    static bool isReservedId(const string& id) { return equalsIgnoreCase(trim(id), "admin"); }
+
+    // On a student login, s receives the record; a plaintext password is
+    // replaced by its hash the first time it is used
+    Access login(const string& username, const string& password, StudentRecord& s);
+};
+
+// Hashes every plaintext password left in the data files (run with:
+// main --migrate-passwords [--threads N]); logins do the same one at a time
+int runMigratePasswords(size_t threads);
+
+// --- Login throttling: failed attempts per username and per source ---
+// A count-min sketch over two windows; past a free allowance each failure
+// sets a deadline, doubling each time, before which attempts are turned
+// away at once, without hashing.
+class SlidingSketch {
+private:
+    static const size_t ROWS = 4, COLS = 4096;
+    uint32_t cells[2][ROWS][COLS];
+    // Earliest next attempt per key: the latest deadline set on any cell, read as the least over the rows
+    int64_t until[ROWS][COLS];
+    int64_t windowOf[2];
+    int64_t windowSecs;
+    size_t column(uint32_t h, size_t row) const;
+    uint32_t countIn(int half, uint32_t h) const;
+    // Clears a half that still holds an older window
+    int half(int64_t window);
+public:
+    explicit SlidingSketch(int64_t seconds);
+    void add(uint32_t h, int64_t nowMs);
+    double estimate(uint32_t h, int64_t nowMs);
+    void holdUntil(uint32_t h, int64_t deadlineMs);
+    int64_t heldUntil(uint32_t h) const;
+};
+
+class LoginThrottle {
+private:
+    static LoginThrottle* instance;
+    mutex lock;
+    SlidingSketch userFailures, sourceFailures;
+    static const int64_t WINDOW_SECS = 300;
+    static const unsigned USER_FREE = 5, SOURCE_FREE = 20;
+    static const int64_t BASE_DELAY_MS = 250, MAX_DELAY_MS = 30000;
+    LoginThrottle() : userFailures(WINDOW_SECS), sourceFailures(WINDOW_SECS) {}
+    static int64_t nowMs();
+    static int64_t backoff(double failures, unsigned free);
+public:
+    static LoginThrottle* getInstance();
+    // Milliseconds until an attempt for this username from this source is
+    // allowed; parallel sessions share the deadline
+    int64_t delayFor(const string& username, const string& source);
+    void recordFailure(const string& username, const string& source);
+};
+
+// --- Console: each session reads and writes its own streams ---
+// The interactive program uses cin/cout; server sessions point these at
+// their socket. A closed input ends the session with SessionClosed.
+extern thread_local istream* sessionIn;
+extern thread_local ostream* sessionOut;
+// Who is on the other end, for login throttling
+extern thread_local string sessionSource;
+istream& termIn();
+ostream& termOut();
+struct SessionClosed {};
+// Time spent here is input wait, which handler timings leave out
+template <class Str>
+void readLine(Str& s) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool ok = (bool)getline(termIn(), s);
+    inputWaitNs += (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    if (!ok) throw SessionClosed();
+}
+
+// --- Display Strategy Pattern ---
+// "taken/cap", or just "taken" for a course without a cap
+string seatText(const CourseRecord& c, size_t taken);
+
+// Views render one page at a time: a page request names the sort order, a
+// limit, and where to resume (a slot in stored order, or the last key shown
+// when sorted). Memory is bounded by the page size, not the dataset.
+// Student pages may be limited to the matches of a filter or to the roster
+// of a course.
+struct PageRequest {
+    SortKey sort;
+    size_t offset, limit;
+    string after;
+    const StudentFilter* filter;
+    // Stored order: the slot to resume at and the Registry's slot layout it
+    // belongs to; offset (rows shown so far) covers a changed layout
+    size_t slot;
+    uint64_t layout;
+    string course;
+};
+struct PageResult {
+    bool more;
+    PageRequest next;
+};
+struct CourseRow {
+    CourseRecord course;
+    size_t taken;
+};
+
+// Pads like setw(width) << left: never truncates
+void appendCell(string& out, const string& s, size_t width);
+
+class DisplayStrategy {
+public:
+    virtual PageResult displayStudents(const PageRequest& page) = 0;
+    virtual PageResult displayCourses(const PageRequest& page) = 0;
+    virtual ~DisplayStrategy() {}
+protected:
+    static string sortKey(string_view id, string_view name, SortKey sort);
+    static string studentKey(const StudentView& s, SortKey sort);
+    static PageResult studentPage(const PageRequest& page, vector<StudentRecord>& rows);
+    static PageResult coursePage(const PageRequest& page, vector<CourseRow>& rows);
+    static void write(const string& out);
+private:
+    // Scans hand out views into the Registry; only rows that are kept are copied
+    static StudentRecord toRow(const StudentView& s) { return s.record(); }
+    static const CourseRow& toRow(const CourseRow& r) { return r; }
+    // Stored pages resume at the cursor's slot. Sorted pages keep the limit+1
+    // smallest keys past the cursor in a max-heap. Either way the extra row
+    // only tells whether another page follows.
+    template <class Row, class Scan, class Resume, class KeyOf>
+    static PageResult collect(const PageRequest& page, Scan scan, Resume resume, KeyOf keyOf, vector<Row>& rows) {
+        PageResult r = {false, page};
+        rows.clear();
+        rows.reserve(page.limit);
+        if (page.sort == SORT_STORED) {
+            resume(r.next, [&](const auto& row) {
+                if (rows.size() == page.limit) {
+                    r.more = true;
+                    return false;
+                }
+                rows.push_back(toRow(row));
+                return true;
+            });
+            r.next.offset = page.offset + rows.size();
+            return r;
+        }
+        typedef pair<string, Row> Entry;
+        auto byKey = [](const Entry& a, const Entry& b) { return a.first < b.first; };
+        vector<Entry> heap;
+        heap.reserve(page.limit + 1);
+        scan([&](const auto& row) {
+            string key = keyOf(row, page.sort);
+            if (!page.after.empty() && key <= page.after) return;
+            if (heap.size() <= page.limit) {
+                heap.emplace_back(move(key), toRow(row));
+                push_heap(heap.begin(), heap.end(), byKey);
+            } else if (key < heap.front().first) {
+                pop_heap(heap.begin(), heap.end(), byKey);
+                heap.back() = Entry(move(key), toRow(row));
+                push_heap(heap.begin(), heap.end(), byKey);
+            }
+        });
+        sort_heap(heap.begin(), heap.end(), byKey);
+        if (heap.size() > page.limit) {
+            r.more = true;
+            heap.pop_back();
+        }
+        for (size_t i = 0; i < heap.size(); ++i) rows.push_back(move(heap[i].second));
+        if (!heap.empty()) r.next.after = heap.back().first;
+        return r;
+    }
+};
+
+class TableView : public DisplayStrategy {
+public:
+    PageResult displayStudents(const PageRequest& page) override;
+    PageResult displayCourses(const PageRequest& page) override;
+};
+
+class SummaryView : public DisplayStrategy {
+public:
+    PageResult displayStudents(const PageRequest& page) override;
+    PageResult displayCourses(const PageRequest& page) override;
+};
+
+// Machine-readable encodings, appended straight into a byte buffer.
+// Password hashes are never part of the output.
+enum OutputFormat { FORMAT_JSON, FORMAT_NDJSON, FORMAT_CSV };
+
+// Digits only, without a leading zero: safe to emit as a bare JSON number
+bool isJsonNumber(string_view s);
+void appendJsonString(string& out, string_view s);
+// Quoted only when it holds a comma, quote or line break (RFC 4180)
+void appendCsvField(string& out, string_view s);
+
+// Writes rows of named fields in one format; numeric fields become JSON
+// numbers when they look like one
+class RecordEncoder {
+private:
+    OutputFormat format;
+    const char* const* names;
+    const bool* numeric;
+    size_t fields, rows;
+public:
+    RecordEncoder(OutputFormat f, const char* const* fieldNames, const bool* numericFields, size_t fieldCount);
+    void begin(string& out);
+    void row(string& out, const string_view* values);
+    void end(string& out);
+};
+
+const char* const STUDENT_FIELDS[5] = {"id", "name", "email", "age", "program"};
+const bool STUDENT_NUMERIC[5] = {false, false, false, true, false};
+const char* const COURSE_FIELDS[5] = {"code", "name", "units", "capacity", "enrolled"};
+const bool COURSE_NUMERIC[5] = {false, false, true, true, true};
+const char* const ENROLLMENT_FIELDS[2] = {"student", "course"};
+const bool ENROLLMENT_NUMERIC[2] = {false, false};
+
+void encodeStudent(RecordEncoder& enc, string& out, const StudentView& s);
+void encodeCourse(RecordEncoder& enc, string& out, const CourseRecord& c, size_t taken);
+
+// The menu's machine-readable views: one page per call, as its own document
+class FormatView : public DisplayStrategy {
+private:
+    OutputFormat format;
+public:
+    explicit FormatView(OutputFormat f) : format(f) {}
+    PageResult displayStudents(const PageRequest& page) override;
+    PageResult displayCourses(const PageRequest& page) override;
+};
+
+// Global pointer for current strategy
+extern thread_local DisplayStrategy* displayStrategy;
+
+// Let user choose display mode
+void chooseDisplayStrategy();
+
+// User base class
+class User {
+protected:
+    string id, name, email, password;
+public:
+    User(const string& id, const string& name, const string& email, const string& password);
+    virtual ~User() {}
+    string getId() const { return id; }
+    string getName() const { return name; }
+    virtual void menu() = 0;
+    virtual int optionCount() const = 0;
+    virtual bool handleOption(int opt) = 0;
+};
+
+// Admin class
+class Admin : public User {
+public:
+    Admin(const string& id, const string& name, const string& email, const string& password);
+    void menu() override;
+    int optionCount() const override { return 12; }
+    bool handleOption(int opt) override;
+};
+
+// Student class
+class Student : public User {
+public:
+    Student(const string& id, const string& name, const string& email, const string& password);
+    void menu() override;
+    int optionCount() const override { return 7; }
+    bool handleOption(int opt) override;
+};
+
+// --- Lookup helpers (answered from the Registry) ---
+bool studentExists(const string& id);
+bool courseExists(const string& code);
+bool isEnrolled(string_view sid, string_view ccode);
+// "Did you mean" lines for an ID or code that matched nothing; a name works too
+const size_t SUGGESTIONS = 5;
+void suggestStudents(string_view input);
+void suggestCourses(string_view input);
+
+// --- Helpers for validation and case-insensitive checks ---
+bool isAlphanumeric(string_view s);
+bool isLettersOnly(string_view s);
+bool isWholeNumber(string_view s);
+bool studentExistsCI(string_view id);
+bool courseExistsCI(string_view code);
+
+// --- Record validation (shared by the menus and batch mode) ---
+// Each check returns an empty string when the value is acceptable,
+// otherwise the message to show
+string checkNewStudentId(const string& id);
+string checkNewCourseCode(const string& code);
+string checkName(const string& name);
+string checkAge(const string& age);
+string checkUnits(const string& units);
+string checkCapacity(const string& capacity);
+// A new cap for an existing course must still fit its roster
+string checkCapacityFor(const string& code, const string& capacity);
+const char* const BELOW_ROSTER = "Capacity is below the students now enrolled; course not updated.";
+// Free-text fields end up in comma-separated files
+string checkFreeText(const string& label, const string& s);
+
+// --- Admin Features ---
+void addStudent();
+void addCourse();
+// Shows a listing a page at a time until it ends or the user stops
+const size_t PAGE_ROWS = 20;
+template <class Show>
+void pageThrough(Show show, PageRequest page = {SORT_STORED, 0, PAGE_ROWS, "", nullptr, 0, 0, ""}) {
+    PageResult r = show(page);
+    while (r.more) {
+        termOut() << "-- Enter: next page, i: sort by ID, n: sort by name, q: stop -- ";
+        string input;
+        readLine(input);
+        input = trim(input);
+        if (input == "q" || input == "Q") break;
+        if (input == "i" || input == "I" || input == "n" || input == "N") {
+            page = {input == "i" || input == "I" ? SORT_ID : SORT_NAME, 0, PAGE_ROWS, "", page.filter, 0, 0, page.course};
+        } else if (input.empty()) {
+            page = r.next;
+        } else {
+            termOut() << "Invalid input.\n";
+            continue;
+        }
+        r = show(page);
+    }
+}
+void viewAllStudents();
+void viewAllCourses();
+// Filtered student listing, answered from the secondary indexes
+void findStudents();
+void viewStudentsPerCourse(RequestArena& arena);
+void editStudent(RequestArena& arena);
+void editCourse();
+void deleteStudent();
+void deleteCourse();
+
+// --- Student Features ---
+void viewProfile(const string& id, RequestArena& arena);
+void enrollCourse(const string& sid, RequestArena& arena);
+void viewEnrolledCourses(const string& sid, RequestArena& arena);
+void editProfile(const string& sid, RequestArena& arena);
+void dropCourse(const string& sid, RequestArena& arena);
+
+// --- Admin Option Handler ---
+// The change is in effect but not on disk; it is retried with the next
+// change and written for good by the next checkpoint
+void reportUnsaved(const JournalError& ex);
+// Each request gets its own arena for its temporaries
+const MetricId ADMIN_METRICS[] = {M_ADD_STUDENT, M_ADD_COURSE, M_VIEW_STUDENTS, M_VIEW_COURSES, M_COURSE_ROSTER, M_EDIT_STUDENT,
+                                   M_EDIT_COURSE, M_DELETE_STUDENT, M_DELETE_COURSE, M_DISPLAY_MODE, M_LOGOUT, M_FIND_STUDENTS};
+
+// --- Student Option Handler ---
+const MetricId STUDENT_METRICS[] = {M_VIEW_PROFILE, M_ENROLL, M_VIEW_ENROLLED, M_EDIT_PROFILE, M_DROP, M_DISPLAY_MODE, M_LOGOUT};
+
+// --- Login ---
+unique_ptr<User> login();
+
+// One interactive session: login, then the menu until the user logs out
+void runSession();
+
+double secondsSince(chrono::steady_clock::time_point start);
+
+// --- Server mode (run with: main --serve [socket], join with: main --connect [socket]) ---
+// The server owns the data files and serves each connection as its own
+// session on its own thread, all sharing the one Registry. Clients are plain
+// terminal bridges between stdin/stdout and the socket.
+#ifndef _WIN32
+class FdStreamBuf : public streambuf {
+    int fd;
+    char inBuf[4096];
+    char outBuf[4096];
+public:
+    explicit FdStreamBuf(int socket);
+    ~FdStreamBuf() { sync(); }
+protected:
+    int_type underflow() override;
+    int_type overflow(int_type ch) override;
+    int sync() override;
+};
+
+void serveSession(int fd);
+bool socketAddress(const string& path, sockaddr_un& addr);
+#endif
+// Without Unix-domain sockets both just report that server mode is unavailable
+int runServer(const string& path);
+int runClient(const string& path);
+
+// --- Batch mode (run with: main --batch ops.jsonl [--group N]) ---
+// One JSON object per line, e.g.
+//   {"op":"add_student","id":"S1","name":"Ana Cruz","email":"ana@x.edu","age":19,"program":"BS IT","password":"pw"}
+//   {"op":"enroll","student":"S1","course":"Inteprog"}
+// Ops: add_student, edit_student, delete_student, add_course, edit_course,
+// delete_course, enroll, drop. Edits only change the fields present.
+
+// Parses a flat JSON object of string/number/bool values into key/value pairs
+bool parseFlatJson(string_view s, vector<pair<string, string> >& out, string& err);
+
+class BatchRecord {
+private:
+    const vector<pair<string, string> >& kv;
+public:
+    explicit BatchRecord(const vector<pair<string, string> >& pairs) : kv(pairs) {}
+    bool has(const string& key) const;
+    string get(const string& key) const;
+};
+
+// Applies one batch line; returns an empty string or the reason it was rejected
+string runBatchOp(const BatchRecord& r);
+
+int runBatch(const string& path, size_t group);
+
+// --- Bulk import (run with: main --import students|courses|enrollments file.csv [--threads N] [--header]) ---
+// --header skips the first row; otherwise only a first row starting with a column
+// name is skipped, and the summary says so. Rejects go to <file>.rejects.txt.
+struct ImportReject {
+    size_t line;
+    string reason;
+};
+
+// Field-level checks only; they need nothing from the store, so they run in parallel
+string checkImportRow(const string& kind, const string_view* f, size_t found);
+
+// checkImportRow over a block of split rows, a column at a time; only rows
+// that fail something go through checkImportRow, for the same messages
+void checkImportRows(const string& kind, const string_view* f, size_t width, const size_t* found, size_t n, string* errors,
+                     const char* readLimit);
+
+int runImport(const string& kind, const string& path, size_t threads, bool header);
+
+// --- Export (run with: main --export students|courses|enrollments [--format json|ndjson|csv] [--out file]) ---
+// Streams the table in 1 MiB chunks; output goes to stdout without --out.
+// Works while a server owns the data files, from a read-only copy of them.
+int runExport(const string& kind, const string& formatName, const string& outPath);
+
+// --- Audit query (run with: main --audit-query [filters]) ---
+// Accepts epoch seconds, YYYY-MM-DD or "YYYY-MM-DD HH:MM" (local time)
+bool parseWhen(const string& s, bool endOfRange, int64_t& out);
+
+int runAuditQuery(int argc, char* argv[]);
+
+#endif